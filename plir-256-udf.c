@@ -6,192 +6,283 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "plir256.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-static inline uint32_t rotate_left(uint32_t x, int n) {
-    return (x << n) | (x >> (32 - n));
-}
+bool PLIR256_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+    if (args->arg_count != 1) {
+        strncpy(message, "PLIR256() requires exactly one string argument.", MYSQL_ERRMSG_SIZE);
+        return true; 
+    }
+    if (args->arg_type[0] != STRING_RESULT) {
+        strncpy(message, "PLIR256() argument must be a string.", MYSQL_ERRMSG_SIZE);
+        return true;
+    }
 
-uint32_t modular_mix(uint32_t x, uint32_t y) {
-    uint32_t result = (x * 33U) ^ (y * 19U) 
-                    + rotate_left(x, 11) 
-                    + rotate_left(y, 15)
-                    + (x >> 3) 
-                    ^ (y << 2);
+    /* Per-statement output buffer; rows of one statement run on one thread. */
+    initid->ptr = (char *)malloc(PLIR256_HEX_SIZE);
+    if (!initid->ptr) {
+        strncpy(message, "PLIR256() could not allocate memory.", MYSQL_ERRMSG_SIZE);
+        return true;
+    }
 
-    return result & 0xFFFFFFFF;
+    initid->maybe_null = 1; 
+    initid->max_length = PLIR256_HEX_SIZE - 1;
+    return false;           
 }
 
-static int sum_ascii(const char *text) {
-    int total = 0;
-    while (*text) {
-        total += (unsigned char)(*text);
-        text++;
+char *PLIR256(UDF_INIT *initid, UDF_ARGS *args, char *result,
+              unsigned long *length, bool *is_null, bool *error)
+{
+    if (!args->args[0]) {
+        *is_null = true;
+        return NULL;
     }
-    return total;
-}
 
-uint32_t* expand_message_deterministic(const char *text, size_t *out_len) {
-    size_t text_len = strlen(text);
-    *out_len = (text_len + 3) / 4;
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256((const uint8_t *)args->args[0], args->lengths[0], digest);
+    plir256_to_hex(digest, initid->ptr);
 
-    uint32_t *blocks = (uint32_t*)malloc(*out_len * sizeof(uint32_t));
-    if (!blocks) {
-        fprintf(stderr, "Memory allocation failed.\n");
-        exit(EXIT_FAILURE);
-    }
+    *length = PLIR256_HEX_SIZE - 1;
+    return initid->ptr;
+}
 
-    int sum_val = sum_ascii(text);
-    uint32_t seed = (uint32_t)(sum_val * 137);
+void PLIR256_deinit(UDF_INIT *initid)
+{
+    free(initid->ptr);
+    initid->ptr = NULL;
+}
 
-    for (size_t i = 0; i < *out_len; i++) {
-        unsigned char chunk[4] = { ' ', ' ', ' ', ' ' };
-        size_t start_idx = i * 4;
-        for (size_t j = 0; j < 4; j++) {
-            if (start_idx + j < text_len) {
-                chunk[j] = (unsigned char)text[start_idx + j];
-            }
-        }
+/*
+ * PLIR256_EX(str, rounds, stages[, salt]): hex PLIR-256 of str || salt with
+ * explicit rounds and stages. Out-of-range settings give NULL.
+ */
+#define PLIR256_UDF_MAX_ROUNDS 4096
+#define PLIR256_UDF_MAX_STAGES 256
 
-        uint32_t block_val = (uint32_t)(chunk[0])
-                           | ((uint32_t)chunk[1] << 8)
-                           | ((uint32_t)chunk[2] << 16)
-                           | ((uint32_t)chunk[3] << 24);
+bool PLIR256_EX_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+    if (args->arg_count != 3 && args->arg_count != 4) {
+        strncpy(message, "PLIR256_EX() requires (str, rounds, stages[, salt]).", MYSQL_ERRMSG_SIZE);
+        return true;
+    }
+    args->arg_type[0] = STRING_RESULT;
+    args->arg_type[1] = INT_RESULT;
+    args->arg_type[2] = INT_RESULT;
+    if (args->arg_count == 4) {
+        args->arg_type[3] = STRING_RESULT;
+    }
 
-        uint32_t shift_val = seed >> (i % 16);
-        block_val ^= shift_val;
+    initid->ptr = (char *)malloc(PLIR256_HEX_SIZE);
+    if (!initid->ptr) {
+        strncpy(message, "PLIR256_EX() could not allocate memory.", MYSQL_ERRMSG_SIZE);
+        return true;
+    }
 
-        seed = rotate_left(seed, 5) ^ (seed * 71U);
+    initid->maybe_null = 1;
+    initid->max_length = PLIR256_HEX_SIZE - 1;
+    return false;
+}
 
-        blocks[i] = block_val;
+char *PLIR256_EX(UDF_INIT *initid, UDF_ARGS *args, char *result,
+                 unsigned long *length, bool *is_null, bool *error)
+{
+    if (!args->args[0] || !args->args[1] || !args->args[2]) {
+        *is_null = true;
+        return NULL;
     }
 
-    return blocks;
-}
+    long long rounds = *(long long *)args->args[1];
+    long long stages = *(long long *)args->args[2];
+    if (rounds < 0 || rounds > PLIR256_UDF_MAX_ROUNDS || stages < 1 || stages > PLIR256_UDF_MAX_STAGES) {
+        *is_null = true;
+        return NULL;
+    }
 
-void single_stage_hash(const char *input_text, uint32_t prev_state, int rounds, char *out_hex) {
-    uint32_t seed = sum_ascii(input_text) * 137;
-    
-    uint32_t h[8];
-    h[0] = (0x86B47C4C ^ seed) ^ prev_state;
-    h[1] = (0xEEDFCBB3 ^ seed) ^ prev_state;  
-    h[2] = (0x1105DC08 ^ seed) ^ prev_state; 
-    h[3] = (0x21FB8A71 ^ seed) ^ prev_state; 
-    h[4] = (0x43B675C9 ^ seed) ^ prev_state;   
-    h[5] = (0x75B803D5 ^ seed) ^ prev_state;  
-    h[6] = (0x864FAAE8 ^ seed) ^ prev_state;  
-    h[7] = (0xD7C261FF ^ seed) ^ prev_state; 
-
-    size_t message_length;
-    uint32_t *message = expand_message_deterministic(input_text, &message_length);
-
-    const uint32_t GOLDEN_RATIO_CONST = 0x9E3779B9;
-
-    for (int i = 0; i < rounds; i++) {
-        uint32_t key = GOLDEN_RATIO_CONST 
-                     ^ (i * 73U)
-                     ^ (h[i % 8] << (i % 6))
-                     ^ (h[(i + 3) % 8] >> (i % 4))
-                     ^ (h[(i + 5) % 8] << (i % 8));
-
-        for (int j = 0; j < 8; j += 2) {
-            uint32_t prev_xor = h[(j + 1) % 8] ^ h[(j + 3) % 8];
-
-            h[j] = modular_mix(h[j], key)
-                 ^ (message[j % message_length] + GOLDEN_RATIO_CONST)
-                 ^ prev_xor;
-            h[j] &= 0xFFFFFFFF;
-
-            h[j + 1] = modular_mix(h[j + 1], rotate_left(h[j], 13))
-                     ^ (h[(j + 3) % 8] >> 5)
-                     ^ (h[(j + 6) % 8] << 3)
-                     ^ rotate_left(h[(j + 7) % 8], 17)
-                     ^ prev_xor;
-            h[j + 1] &= 0xFFFFFFFF;
-        }
+    plir256_ctx ctx;
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256_init_ex(&ctx, (int)rounds, (int)stages);
+    plir256_update(&ctx, (const uint8_t *)args->args[0], args->lengths[0]);
+    if (args->arg_count == 4 && args->args[3]) {
+        plir256_update(&ctx, (const uint8_t *)args->args[3], args->lengths[3]);
     }
+    plir256_final(&ctx, digest);
+    plir256_to_hex(digest, initid->ptr);
 
-    free(message);
-    sprintf(out_hex,
-        "%08x%08x%08x%08x%08x%08x%08x%08x",
-        h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]
-    );
+    *length = PLIR256_HEX_SIZE - 1;
+    return initid->ptr;
 }
 
-void secure_plir_256(const char *text, int rounds, int stages, char *out_hex) {
-    char stage_hash[65];
-    stage_hash[64] = '\0';
+void PLIR256_EX_deinit(UDF_INIT *initid)
+{
+    free(initid->ptr);
+    initid->ptr = NULL;
+}
 
-    uint32_t state = 0U;
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
 
-    char *current_input = (char*)malloc(strlen(text) + 1);
-    if (!current_input) {
-        fprintf(stderr, "Memory allocation failed.\n");
-        exit(EXIT_FAILURE);
+/*
+ * PLIR256_VERIFY(stored_record, candidate): 1 if candidate is the password of
+ * an ITER + SALT + HASH record (as printed by plirsum --kdf), else 0. HASH is
+ * the last 64 hex characters, ITER the leading digits and SALT, which never
+ * starts with a digit, the rest. Records with ITER above
+ * PLIR256_KDF_MAX_ITERATIONS are rejected without hashing, so one row costs
+ * a bounded amount of work. The digests are compared in constant time.
+ */
+bool PLIR256_VERIFY_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+    if (args->arg_count != 2) {
+        strncpy(message, "PLIR256_VERIFY() requires (stored_record, candidate).", MYSQL_ERRMSG_SIZE);
+        return true;
     }
-    strcpy(current_input, text);
+    args->arg_type[0] = STRING_RESULT;
+    args->arg_type[1] = STRING_RESULT;
 
-    for (int s = 0; s < stages; s++) {
-        single_stage_hash(current_input, state, rounds, stage_hash);
+    initid->maybe_null = 0;
+    return false;
+}
 
-        char temp[9];
-        memcpy(temp, stage_hash, 8);
-        temp[8] = '\0';
-        uint32_t partial = (uint32_t)strtoul(temp, NULL, 16);
-        state ^= partial;
+long long PLIR256_VERIFY(UDF_INIT *initid, UDF_ARGS *args, bool *is_null, bool *error)
+{
+    const char *record = args->args[0];
+    unsigned long record_len = args->lengths[0];
+    if (!record || !args->args[1] || record_len < 2 * PLIR256_DIGEST_SIZE + 1) {
+        return 0;
+    }
+
+    uint8_t expected[PLIR256_DIGEST_SIZE];
+    const char *hex = record + record_len - 2 * PLIR256_DIGEST_SIZE;
+    for (int i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+        int hi = hex_value(hex[2 * i]), lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return 0;
+        }
+        expected[i] = (uint8_t)(hi << 4 | lo);
+    }
 
-        free(current_input);
-        current_input = (char*)malloc(65);
-        if (!current_input) {
-            fprintf(stderr, "Memory allocation failed.\n");
-            exit(EXIT_FAILURE);
+    size_t prefix_len = (size_t)(hex - record);
+    size_t digits = 0;
+    uint32_t iterations = 0;
+    while (digits < prefix_len && record[digits] >= '0' && record[digits] <= '9') {
+        iterations = iterations * 10 + (uint32_t)(record[digits] - '0');
+        if (iterations > PLIR256_KDF_MAX_ITERATIONS) {
+            return 0;
         }
-        strcpy(current_input, stage_hash);
+        digits++;
+    }
+    if (digits == 0 || record[0] == '0') {
+        return 0;
     }
 
-    strcpy(out_hex, stage_hash);
-    free(current_input);
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256_kdf((const uint8_t *)args->args[1], args->lengths[1],
+                (const uint8_t *)record + digits, prefix_len - digits, iterations, digest);
+    unsigned char diff = 0;
+    for (int i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+        diff |= digest[i] ^ expected[i];
+    }
+    return diff == 0;
 }
 
-bool PLIR256_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+/*
+ * PLIR256_AGG(expr): order-independent fingerprint of a group. Each non-NULL
+ * value is hashed and its digest, read as a 256-bit big-endian integer, is
+ * added modulo 2^256; the result is the hex of that sum, or NULL for a group
+ * with no values. Fingerprints of disjoint groups can be added the same way.
+ */
+typedef struct {
+    uint64_t acc[4];        /* acc[0] is the most significant word */
+    uint64_t rows;
+    char hex[PLIR256_HEX_SIZE];
+} plir256_agg_state;
+
+bool PLIR256_AGG_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
     if (args->arg_count != 1) {
-        strncpy(message, "PLIR256() requires exactly one string argument.", MYSQL_ERRMSG_SIZE);
-        return true; 
+        strncpy(message, "PLIR256_AGG() requires exactly one argument.", MYSQL_ERRMSG_SIZE);
+        return true;
     }
-    if (args->arg_type[0] != STRING_RESULT) {
-        strncpy(message, "PLIR256() argument must be a string.", MYSQL_ERRMSG_SIZE);
+    args->arg_type[0] = STRING_RESULT;
+
+    initid->ptr = (char *)calloc(1, sizeof(plir256_agg_state));
+    if (!initid->ptr) {
+        strncpy(message, "PLIR256_AGG() could not allocate memory.", MYSQL_ERRMSG_SIZE);
         return true;
     }
 
-    initid->maybe_null = 1; 
-    return false;           
+    initid->maybe_null = 1;
+    initid->max_length = PLIR256_HEX_SIZE - 1;
+    return false;
 }
 
-char *PLIR256(UDF_INIT *initid, UDF_ARGS *args, char *result,
-              unsigned long *length, bool *is_null, bool *error)
+void PLIR256_AGG_deinit(UDF_INIT *initid)
 {
-    if (!args->args[0]) {
-        *is_null = true;
-        return NULL;
-    }
+    free(initid->ptr);
+    initid->ptr = NULL;
+}
 
-    static char hash_result[65];
-    hash_result[64] = '\0';
+void PLIR256_AGG_clear(UDF_INIT *initid, bool *is_null, bool *error)
+{
+    plir256_agg_state *state = (plir256_agg_state *)initid->ptr;
+    memset(state->acc, 0, sizeof(state->acc));
+    state->rows = 0;
+}
 
-    secure_plir_256(args->args[0], 8, 2, hash_result);
+void PLIR256_AGG_add(UDF_INIT *initid, UDF_ARGS *args, bool *is_null, bool *error)
+{
+    if (!args->args[0]) {
+        return;
+    }
 
-    strcpy(result, hash_result);
-    *length = (unsigned long)strlen(hash_result);
+    plir256_agg_state *state = (plir256_agg_state *)initid->ptr;
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256((const uint8_t *)args->args[0], args->lengths[0], digest);
 
-    return result;
+    uint64_t carry = 0;
+    for (int w = 3; w >= 0; w--) {
+        uint64_t word = 0;
+        for (int b = 0; b < 8; b++) {
+            word = word << 8 | digest[8 * w + b];
+        }
+        uint64_t sum = state->acc[w] + word;
+        uint64_t next = sum < word;
+        sum += carry;
+        next |= sum < carry;
+        state->acc[w] = sum;
+        carry = next;
+    }
+    state->rows++;
 }
 
-void PLIR256_deinit(UDF_INIT *initid)
+char *PLIR256_AGG(UDF_INIT *initid, UDF_ARGS *args, char *result,
+                  unsigned long *length, bool *is_null, bool *error)
 {
+    plir256_agg_state *state = (plir256_agg_state *)initid->ptr;
+    if (state->rows == 0) {
+        *is_null = true;
+        return NULL;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    for (int w = 0; w < 4; w++) {
+        for (int b = 0; b < 8; b++) {
+            digest[8 * w + b] = (uint8_t)(state->acc[w] >> (56 - 8 * b));
+        }
+    }
+    plir256_to_hex(digest, state->hex);
 
+    *length = PLIR256_HEX_SIZE - 1;
+    return state->hex;
 }
 
 #ifdef __cplusplus
@@ -12,23 +12,24 @@ def modular_mix(x, y):
     x &= 0xFFFFFFFF
     y &= 0xFFFFFFFF
 
-    part = ((x * 33) ^ (y * 19)) & 0xFFFFFFFF
+    # Same grouping as C, where + binds tighter than ^.
+    part = (y * 19) & 0xFFFFFFFF
     part = (part + rotate_left(x, 11)) & 0xFFFFFFFF
     part = (part + rotate_left(y, 15)) & 0xFFFFFFFF
     part = (part + (x >> 3)) & 0xFFFFFFFF
 
-    result = part ^ (y << 2)
+    result = ((x * 33) & 0xFFFFFFFF) ^ part ^ (y << 2)
     return result & 0xFFFFFFFF
 
 def sum_ascii(text):
     total = 0
     for ch in text:
-        total += ord(ch)
+        total += ch
     return total
 
 def expand_message_deterministic(text):
     text_len = len(text)
-    out_len = (text_len + 3) // 4 
+    out_len = max((text_len + 3) // 4, 1)   # empty input is one block of padding
 
     blocks = []
     s_val = sum_ascii(text)
@@ -39,7 +40,7 @@ def expand_message_deterministic(text):
         start_idx = i * 4
         for j in range(4):
             if (start_idx + j) < text_len:
-                chunk[j] = ord(text[start_idx + j])
+                chunk[j] = text[start_idx + j]
 
         block_val = (chunk[0]
                     | (chunk[1] << 8)
@@ -104,12 +105,15 @@ def single_stage_hash(input_text, prev_state, rounds):
     out_hex = ''.join(f'{val:08x}' for val in h)
     return out_hex
 
-def secure_plir_256(text, rounds, stages):
+def py_secure_plir_256(text, rounds=8, stages=2):
+    """Pure-Python reference; text is bytes, or str hashed as UTF-8."""
+    if isinstance(text, str):
+        text = text.encode('utf-8')
     state = 0
-    current_input = text
+    current_input = bytes(text)
 
     stage_hash = ""
-    for s in range(stages):
+    for s in range(max(stages, 1)):
         stage_hash = single_stage_hash(current_input, state, rounds)
 
         partial_str = stage_hash[:8]  
@@ -117,10 +121,21 @@ def secure_plir_256(text, rounds, stages):
         state ^= partial_val
         state &= 0xFFFFFFFF
 
-        current_input = stage_hash
+        current_input = stage_hash.encode('ascii')
 
     return stage_hash
 
+def py_hash_many(items, rounds=8, stages=2):
+    return [py_secure_plir_256(item, rounds, stages) for item in items]
+
+# The C extension (make python) computes identical digests; this file is the
+# fallback when it is not built and the reference it is checked against.
+try:
+    from plir256 import secure_plir_256, hash_many
+except ImportError:
+    secure_plir_256 = py_secure_plir_256
+    hash_many = py_hash_many
+
 def constant_time_compare(val1, val2):
     if len(val1) != len(val2):
         return False
@@ -130,7 +145,29 @@ def constant_time_compare(val1, val2):
         result |= (ord(x) ^ ord(y))
     return (result == 0)
 
+def check_native(cases=2000):
+    """Compares the C extension with the pure-Python reference."""
+    import os
+    import random
+    import plir256
+
+    rng = random.Random(256)
+    items = [os.urandom(rng.choice((0, 1, 3, 4, 27, 28, 29, 64, 200))) for _ in range(cases)]
+    items += ["Password", "", "h\u00e9llo \u2603"]
+    failures = 0
+    for rounds, stages in ((8, 2), (0, 1), (12, 3), (17, 1)):
+        expected = py_hash_many(items, rounds, stages)
+        failures += sum(a != b for a, b in zip(plir256.hash_many(items, rounds, stages), expected))
+        failures += sum(plir256.secure_plir_256(item, rounds, stages) != e
+                        for item, e in zip(items, expected))
+    print(f"{4 * len(items)} cases, {failures} mismatches")
+    return failures == 0
+
 def main():
+    import sys
+    if sys.argv[1:] == ['--check']:
+        sys.exit(0 if check_native() else 1)
+
     input_text = input("Enter text to hash: ").rstrip('\n')
 
     hash_result = secure_plir_256(input_text, rounds=8, stages=2)
@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "plir256.h"
+
+/*
+ * Reference implementation: the original string-based algorithm, kept as it
+ * was apart from an unsigned byte sum (the original int sum overflows on large
+ * inputs) and parentheses spelling out modular_mix's operator precedence.
+ * Every variant is cross-checked against it.
+ */
+static inline uint32_t ref_rotate_left(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t ref_modular_mix(uint32_t x, uint32_t y) {
+    uint32_t result = (x * 33U) ^ ((y * 19U)
+                    + ref_rotate_left(x, 11)
+                    + ref_rotate_left(y, 15)
+                    + (x >> 3))
+                    ^ (y << 2);
+    return result & 0xFFFFFFFF;
+}
+
+static uint32_t ref_sum_ascii(const char *text) {
+    uint32_t total = 0;
+    while (*text) {
+        total += (unsigned char)(*text);
+        text++;
+    }
+    return total;
+}
+
+static uint32_t *ref_expand_message_deterministic(const char *text, size_t *out_len) {
+    size_t text_len = strlen(text);
+    *out_len = (text_len + 3) / 4;
+
+    uint32_t *blocks = (uint32_t*)malloc(*out_len * sizeof(uint32_t));
+    if (!blocks) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t seed = ref_sum_ascii(text) * 137U;
+
+    for (size_t i = 0; i < *out_len; i++) {
+        unsigned char chunk[4] = { ' ', ' ', ' ', ' ' };
+        size_t start_idx = i * 4;
+        for (size_t j = 0; j < 4; j++) {
+            if (start_idx + j < text_len) {
+                chunk[j] = (unsigned char)text[start_idx + j];
+            }
+        }
+
+        uint32_t block_val = (uint32_t)(chunk[0])
+                           | ((uint32_t)chunk[1] << 8)
+                           | ((uint32_t)chunk[2] << 16)
+                           | ((uint32_t)chunk[3] << 24);
+
+        uint32_t shift_val = seed >> (i % 16);
+        block_val ^= shift_val;
+
+        seed = ref_rotate_left(seed, 5) ^ (seed * 71U);
+        blocks[i] = block_val;
+    }
+
+    return blocks;
+}
+
+static void ref_single_stage_hash(const char *input_text, uint32_t prev_state, int rounds, char *out_hex) {
+    uint32_t seed = ref_sum_ascii(input_text) * 137U;
+
+    uint32_t h[8];
+    h[0] = (0x86B47C4C ^ seed) ^ prev_state;
+    h[1] = (0xEEDFCBB3 ^ seed) ^ prev_state;
+    h[2] = (0x1105DC08 ^ seed) ^ prev_state;
+    h[3] = (0x21FB8A71 ^ seed) ^ prev_state;
+    h[4] = (0x43B675C9 ^ seed) ^ prev_state;
+    h[5] = (0x75B803D5 ^ seed) ^ prev_state;
+    h[6] = (0x864FAAE8 ^ seed) ^ prev_state;
+    h[7] = (0xD7C261FF ^ seed) ^ prev_state;
+
+    size_t message_length;
+    uint32_t *message = ref_expand_message_deterministic(input_text, &message_length);
+
+    const uint32_t GOLDEN_RATIO_CONST = 0x9E3779B9;
+
+    for (int i = 0; i < rounds; i++) {
+        uint32_t key = GOLDEN_RATIO_CONST
+                     ^ (i * 73U)
+                     ^ (h[i % 8] << (i % 6))
+                     ^ (h[(i + 3) % 8] >> (i % 4))
+                     ^ (h[(i + 5) % 8] << (i % 8));
+
+        for (int j = 0; j < 8; j += 2) {
+            uint32_t prev_xor = h[(j + 1) % 8] ^ h[(j + 3) % 8];
+
+            h[j] = ref_modular_mix(h[j], key)
+                 ^ (message[j % message_length] + GOLDEN_RATIO_CONST)
+                 ^ prev_xor;
+            h[j] &= 0xFFFFFFFF;
+
+            h[j + 1] = ref_modular_mix(h[j + 1], ref_rotate_left(h[j], 13))
+                     ^ (h[(j + 3) % 8] >> 5)
+                     ^ (h[(j + 6) % 8] << 3)
+                     ^ ref_rotate_left(h[(j + 7) % 8], 17)
+                     ^ prev_xor;
+            h[j + 1] &= 0xFFFFFFFF;
+        }
+    }
+
+    free(message);
+    sprintf(out_hex,
+            "%08x%08x%08x%08x%08x%08x%08x%08x",
+            h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+}
+
+static void ref_secure_plir_256(const char *text, int rounds, int stages, char *out_hex) {
+    char stage_hash[65];
+    stage_hash[64] = '\0';
+
+    uint32_t state = 0U;
+    char *current_input = (char*)malloc(strlen(text) + 1);
+    if (!current_input) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(current_input, text);
+
+    for (int s = 0; s < stages; s++) {
+        ref_single_stage_hash(current_input, state, rounds, stage_hash);
+
+        char temp[9];
+        memcpy(temp, stage_hash, 8);
+        temp[8] = '\0';
+        uint32_t partial = (uint32_t)strtoul(temp, NULL, 16);
+        state ^= partial;
+
+        free(current_input);
+        current_input = (char*)malloc(65);
+        if (!current_input) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        strcpy(current_input, stage_hash);
+    }
+
+    strcpy(out_hex, stage_hash);
+    free(current_input);
+}
+
+#define MAX_LIST     32
+#define BATCH_SIZE   64
+#define STREAM_CHUNK (64 * 1024)
+
+enum {
+    VARIANT_REFERENCE,
+    VARIANT_SCALAR,
+    VARIANT_SIMD,
+    VARIANT_BATCH,
+    VARIANT_STREAM,
+    VARIANT_KEYED,
+    VARIANT_UDF,
+    VARIANT_FILE,
+    VARIANT_COUNT
+};
+
+static const char *const variant_names[VARIANT_COUNT] = {
+    "reference", "scalar", "simd", "batch", "stream", "keyed", "udf", "file"
+};
+
+typedef struct {
+    size_t sizes[MAX_LIST];
+    int n_sizes;
+    int rounds[MAX_LIST];
+    int stages[MAX_LIST];
+    int n_settings;
+    int variants[VARIANT_COUNT];
+    int n_variants;
+    int reps;
+    int warmup;
+    double min_sample_ns;
+    int json;
+} bench_options;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int rounds;
+    int stages;
+    const char *file_path;
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    char hex[PLIR256_HEX_SIZE];
+    plir256_ctx key;        /* first half of data, for the keyed variant */
+} bench_case;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+ * The plirsum path for a regular file: map it, hash it in one call and format
+ * the hex. Empty files cannot be mapped, so plirsum streams those with fread.
+ */
+static int hash_file(const char *path, int rounds, int stages, char out_hex[PLIR256_HEX_SIZE]) {
+    static uint8_t buffer[STREAM_CHUNK];
+    FILE *fp = fopen(path, "rb");
+    struct stat st;
+    if (!fp || fstat(fileno(fp), &st) != 0) {
+        perror("Could not open file");
+        return 1;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    void *map = st.st_size > 0
+              ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0) : MAP_FAILED;
+    if (map != MAP_FAILED) {
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+        madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+        plir256_ex((const uint8_t *)map, (size_t)st.st_size, rounds, stages, digest);
+        munmap(map, (size_t)st.st_size);
+    } else {
+        plir256_ctx ctx;
+        plir256_init_ex(&ctx, rounds, stages);
+        size_t read_bytes;
+        while ((read_bytes = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+            plir256_update(&ctx, buffer, read_bytes);
+        }
+        plir256_final(&ctx, digest);
+    }
+    fclose(fp);
+    plir256_to_hex(digest, out_hex);
+    return 0;
+}
+
+/*
+ * The UDF row functions: PLIR256(str) hashes (args, lengths) with plir256(),
+ * PLIR256_EX(str, rounds, stages) streams it through a context; both write
+ * the hex into the per-statement buffer.
+ */
+static void hash_udf(const bench_case *c, char out_hex[PLIR256_HEX_SIZE]) {
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    if (c->rounds == PLIR256_DEFAULT_ROUNDS && c->stages == PLIR256_DEFAULT_STAGES) {
+        plir256(c->data, c->size, digest);
+    } else {
+        plir256_ctx ctx;
+        plir256_init_ex(&ctx, c->rounds, c->stages);
+        plir256_update(&ctx, c->data, c->size);
+        plir256_final(&ctx, digest);
+    }
+    plir256_to_hex(digest, out_hex);
+}
+
+/*
+ * Runs one unit of work for a variant and returns the number of hashes done.
+ * The reference, udf and file variants leave hex output in c->hex; see case_digest().
+ */
+static size_t run_variant(int variant, bench_case *c) {
+    switch (variant) {
+    case VARIANT_REFERENCE:
+        ref_secure_plir_256((const char *)c->data, c->rounds, c->stages, c->hex);
+        return 1;
+    case VARIANT_SCALAR:
+    case VARIANT_SIMD:
+        plir256_ex(c->data, c->size, c->rounds, c->stages, c->digest);
+        return 1;
+    case VARIANT_BATCH: {
+        const uint8_t *msgs[BATCH_SIZE];
+        size_t lens[BATCH_SIZE];
+        uint8_t out[BATCH_SIZE][PLIR256_DIGEST_SIZE];
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            msgs[i] = c->data;
+            lens[i] = c->size;
+        }
+        plir256_hash_batch(msgs, lens, BATCH_SIZE, out, c->rounds, c->stages);
+        memcpy(c->digest, out[BATCH_SIZE - 1], PLIR256_DIGEST_SIZE);
+        return BATCH_SIZE;
+    }
+    case VARIANT_STREAM: {
+        plir256_ctx ctx;
+        plir256_init_ex(&ctx, c->rounds, c->stages);
+        for (size_t off = 0; off < c->size; off += STREAM_CHUNK) {
+            size_t n = c->size - off < STREAM_CHUNK ? c->size - off : STREAM_CHUNK;
+            plir256_update(&ctx, c->data + off, n);
+        }
+        plir256_final(&ctx, c->digest);
+        return 1;
+    }
+    case VARIANT_KEYED: {
+        size_t key_len = c->size / 2;
+        const uint8_t *msgs[BATCH_SIZE];
+        size_t lens[BATCH_SIZE];
+        uint8_t out[BATCH_SIZE][PLIR256_DIGEST_SIZE];
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            msgs[i] = c->data + key_len;
+            lens[i] = c->size - key_len;
+        }
+        plir256_keyed_batch(&c->key, msgs, lens, BATCH_SIZE, out);
+        memcpy(c->digest, out[BATCH_SIZE - 1], PLIR256_DIGEST_SIZE);
+        return BATCH_SIZE;
+    }
+    case VARIANT_UDF:
+        hash_udf(c, c->hex);
+        return 1;
+    case VARIANT_FILE:
+        if (hash_file(c->file_path, c->rounds, c->stages, c->hex) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void case_digest(int variant, bench_case *c) {
+    if (variant == VARIANT_REFERENCE || variant == VARIANT_UDF || variant == VARIANT_FILE) {
+        for (int i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+            unsigned int byte;
+            sscanf(c->hex + 2 * i, "%2x", &byte);
+            c->digest[i] = (uint8_t)byte;
+        }
+    }
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+    int idx = (int)(p / 100.0 * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+static int parse_size(const char *text, size_t *out) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) {
+        return -1;
+    }
+    switch (*end) {
+    case 'K': case 'k': value <<= 10; end++; break;
+    case 'M': case 'm': value <<= 20; end++; break;
+    case 'G': case 'g': value <<= 30; end++; break;
+    }
+    if (*end != '\0' || value == 0) {
+        return -1;
+    }
+    *out = (size_t)value;
+    return 0;
+}
+
+static int parse_options(int argc, char *argv[], bench_options *opt) {
+    static const size_t default_sizes[] = { 8, 64, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+
+    memset(opt, 0, sizeof(*opt));
+    for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+        opt->sizes[opt->n_sizes++] = default_sizes[i];
+    }
+    opt->rounds[0] = PLIR256_DEFAULT_ROUNDS;
+    opt->stages[0] = PLIR256_DEFAULT_STAGES;
+    opt->n_settings = 1;
+    for (int v = VARIANT_REFERENCE; v <= VARIANT_UDF; v++) {
+        opt->variants[opt->n_variants++] = v;
+    }
+    opt->reps = 15;
+    opt->warmup = 3;
+    opt->min_sample_ns = 2e6;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--json") == 0) {
+            opt->json = 1;
+            continue;
+        }
+        if (!value) {
+            return -1;
+        }
+        i++;
+
+        char list[1024];
+        snprintf(list, sizeof(list), "%s", value);
+
+        if (strcmp(arg, "--sizes") == 0) {
+            opt->n_sizes = 0;
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                if (opt->n_sizes == MAX_LIST || parse_size(tok, &opt->sizes[opt->n_sizes]) != 0) {
+                    return -1;
+                }
+                opt->n_sizes++;
+            }
+        } else if (strcmp(arg, "--settings") == 0) {
+            opt->n_settings = 0;
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                if (opt->n_settings == MAX_LIST
+                    || sscanf(tok, "%d/%d", &opt->rounds[opt->n_settings], &opt->stages[opt->n_settings]) != 2) {
+                    return -1;
+                }
+                opt->n_settings++;
+            }
+        } else if (strcmp(arg, "--variants") == 0) {
+            opt->n_variants = 0;
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                int found = -1;
+                for (int v = 0; v < VARIANT_COUNT; v++) {
+                    if (strcmp(tok, variant_names[v]) == 0) {
+                        found = v;
+                    }
+                }
+                if (found < 0 || opt->n_variants == VARIANT_COUNT) {
+                    return -1;
+                }
+                opt->variants[opt->n_variants++] = found;
+            }
+        } else if (strcmp(arg, "--reps") == 0) {
+            opt->reps = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            opt->warmup = atoi(value);
+        } else if (strcmp(arg, "--min-sample-ms") == 0) {
+            opt->min_sample_ns = atof(value) * 1e6;
+        } else {
+            return -1;
+        }
+    }
+
+    return (opt->reps > 0 && opt->warmup >= 0) ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    printf(
+        "Usage: %s [options]\n\n"
+        "Options:\n"
+        "  --sizes LIST        Input sizes, K/M/G suffixes allowed (default 8,64,1K,64K,1M,16M).\n"
+        "  --settings LIST     rounds/stages pairs (default 8/2), e.g. 8/2,16/4.\n"
+        "  --variants LIST     Any of reference,scalar,simd,batch,stream,keyed,udf,file\n"
+        "                      (default all but file).\n"
+        "  --reps N            Timed samples per case (default 15).\n"
+        "  --warmup N          Untimed samples per case (default 3).\n"
+        "  --min-sample-ms MS  Minimum duration of one sample (default 2).\n"
+        "  --json              Machine-readable output.\n\n"
+        "Every variant's digest is checked against the reference implementation;\n"
+        "the exit status is 1 if any digest differs.\n",
+        prog);
+}
+
+int main(int argc, char *argv[]) {
+    bench_options opt;
+    if (parse_options(argc, argv, &opt) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t max_size = 0;
+    int wants_file = 0;
+    for (int i = 0; i < opt.n_sizes; i++) {
+        if (opt.sizes[i] > max_size) {
+            max_size = opt.sizes[i];
+        }
+    }
+    for (int i = 0; i < opt.n_variants; i++) {
+        wants_file |= opt.variants[i] == VARIANT_FILE;
+    }
+
+    /* Bytes 1..255 only, so the NUL-terminated reference sees the whole input. */
+    uint8_t *data = (uint8_t*)malloc(max_size + 1);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < max_size; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (uint8_t)(1 + x % 255);
+    }
+
+    char file_path[] = "/tmp/plir-bench-XXXXXX";
+    const char *impl = plir256_impl_name();
+    int mismatches = 0;
+    int first = 1;
+
+    if (opt.json) {
+        printf("{\"impl\":\"%s\",\"reps\":%d,\"warmup\":%d,\"results\":[", impl, opt.reps, opt.warmup);
+    } else {
+        printf("PLIR-256 benchmark (best kernels: %s)\n\n", impl);
+        printf("%-10s %12s %8s %12s %12s %12s %12s %10s %s\n",
+               "variant", "size", "r/s", "min ns", "median ns", "p90 ns", "p99 ns", "GB/s", "digest");
+    }
+
+    double *samples = (double*)malloc((size_t)opt.reps * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    for (int si = 0; si < opt.n_sizes; si++) {
+        size_t size = opt.sizes[si];
+        uint8_t saved = data[size];
+        data[size] = '\0';
+
+        if (wants_file) {
+            int fd = mkstemp(file_path);
+            FILE *fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+            if (!fp || fwrite(data, 1, size, fp) != size || fclose(fp) != 0) {
+                perror("Could not write benchmark file");
+                return 1;
+            }
+        }
+
+        for (int ci = 0; ci < opt.n_settings; ci++) {
+            bench_case c = { .data = data, .size = size, .rounds = opt.rounds[ci], .stages = opt.stages[ci],
+                              .file_path = file_path };
+            uint8_t expected[PLIR256_DIGEST_SIZE];
+            plir256_keyed_init(&c.key, data, size / 2, c.rounds, c.stages);
+
+            run_variant(VARIANT_REFERENCE, &c);
+            case_digest(VARIANT_REFERENCE, &c);
+            memcpy(expected, c.digest, sizeof(expected));
+
+            for (int vi = 0; vi < opt.n_variants; vi++) {
+                int variant = opt.variants[vi];
+                plir256_set_impl(variant == VARIANT_SCALAR ? "scalar" : "auto");
+
+                size_t per_sample = 1;
+                double start = now_ns();
+                size_t hashes = run_variant(variant, &c);
+                double elapsed = now_ns() - start;
+                while (elapsed * (double)per_sample < opt.min_sample_ns && per_sample < ((size_t)1 << 30)) {
+                    per_sample *= 2;
+                }
+
+                for (int w = 0; w < opt.warmup; w++) {
+                    for (size_t k = 0; k < per_sample; k++) {
+                        run_variant(variant, &c);
+                    }
+                }
+                for (int r = 0; r < opt.reps; r++) {
+                    start = now_ns();
+                    for (size_t k = 0; k < per_sample; k++) {
+                        run_variant(variant, &c);
+                    }
+                    samples[r] = (now_ns() - start) / (double)(per_sample * hashes);
+                }
+                qsort(samples, (size_t)opt.reps, sizeof(double), compare_double);
+                case_digest(variant, &c);
+
+                int ok = memcmp(c.digest, expected, sizeof(expected)) == 0;
+                mismatches += !ok;
+
+                double median = percentile(samples, opt.reps, 50);
+                double gbps = (double)size / median;
+                char hex[PLIR256_HEX_SIZE];
+                plir256_to_hex(c.digest, hex);
+
+                if (opt.json) {
+                    printf("%s{\"variant\":\"%s\",\"size\":%zu,\"rounds\":%d,\"stages\":%d,"
+                           "\"min_ns\":%.1f,\"median_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,"
+                           "\"gb_per_s\":%.3f,\"digest\":\"%s\",\"digest_ok\":%s}",
+                           first ? "" : ",", variant_names[variant], size, c.rounds, c.stages,
+                           samples[0], median, percentile(samples, opt.reps, 90),
+                           percentile(samples, opt.reps, 99), gbps, hex, ok ? "true" : "false");
+                    first = 0;
+                } else {
+                    char rs[24];
+                    snprintf(rs, sizeof(rs), "%d/%d", c.rounds, c.stages);
+                    printf("%-10s %12zu %8s %12.1f %12.1f %12.1f %12.1f %10.3f %s\n",
+                           variant_names[variant], size, rs, samples[0], median,
+                           percentile(samples, opt.reps, 90), percentile(samples, opt.reps, 99),
+                           gbps, ok ? "ok" : "MISMATCH");
+                }
+                fflush(stdout);
+            }
+        }
+
+        plir256_set_impl("auto");
+        if (wants_file) {
+            remove(file_path);
+            strcpy(file_path, "/tmp/plir-bench-XXXXXX");
+        }
+        data[size] = saved;
+    }
+
+    if (opt.json) {
+        printf("],\"mismatches\":%d}\n", mismatches);
+    } else if (mismatches) {
+        printf("\n%d variant(s) produced a digest different from the reference.\n", mismatches);
+    }
+
+    free(samples);
+    free(data);
+    return mismatches ? 1 : 0;
+}
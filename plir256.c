@@ -0,0 +1,913 @@
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PLIR256_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#include "plir256.h"
+
+#if defined(PLIR256_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PLIR256_PROBE3(name, a, b, c) DTRACE_PROBE3(plir256, name, a, b, c)
+#endif
+#endif
+#ifndef PLIR256_PROBE3
+#define PLIR256_PROBE3(name, a, b, c) ((void)0)
+#endif
+
+#define GOLDEN_RATIO_CONST 0x9E3779B9U
+
+/*
+ * Per-phase counters, compiled in with -DPLIR256_STATS (make STATS=1). Each
+ * thread claims its own cache-line-aligned slot, so counting adds no sharing
+ * between threads; plir256_stats() sums the slots. Cycles are TSC ticks on
+ * x86 and nanoseconds elsewhere.
+ */
+#ifdef PLIR256_STATS
+#include <time.h>
+
+#define PLIR256_STATS_SLOTS 64
+
+typedef struct {
+    plir256_phase_stats phase[PLIR256_PHASE_COUNT];
+} __attribute__((aligned(64))) stats_slot;
+
+static stats_slot stats_slots[PLIR256_STATS_SLOTS];
+static unsigned stats_slots_used;
+static __thread stats_slot *stats_mine;
+
+static inline uint64_t stats_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void stats_add(int phase, uint64_t calls, uint64_t bytes, uint64_t start) {
+    uint64_t cycles = stats_now() - start;
+    if (!stats_mine) {
+        unsigned i = __atomic_fetch_add(&stats_slots_used, 1, __ATOMIC_RELAXED);
+        stats_mine = &stats_slots[i < PLIR256_STATS_SLOTS ? i : PLIR256_STATS_SLOTS - 1];
+    }
+    /* Atomic only because threads beyond the last slot share it. */
+    plir256_phase_stats *p = &stats_mine->phase[phase];
+    __atomic_fetch_add(&p->calls, calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->cycles, cycles, __ATOMIC_RELAXED);
+}
+
+#define STATS_BEGIN(t)                      uint64_t t = stats_now()
+#define STATS_END(phase, calls, bytes, t)   stats_add(phase, calls, bytes, t)
+#else
+#define STATS_BEGIN(t)                      ((void)0)
+#define STATS_END(phase, calls, bytes, t)   ((void)0)
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/*
+ * The round loop reads message[j % message_length] for j in {0, 2, 4, 6} only,
+ * so expansion produces just those four words.
+ */
+#define PLIR256_MESSAGE_WORDS 4
+#define PLIR256_LIVE_BLOCKS   (PLIR256_HEAD_SIZE / 4)
+
+static inline uint32_t rotate_left(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t modular_mix(uint32_t x, uint32_t y) {
+    uint32_t result = (x * 33U)
+                    ^ ((y * 19U)
+                       + rotate_left(x, 11)
+                       + rotate_left(y, 15)
+                       + (x >> 3))
+                    ^ (y << 2);
+    return result;
+}
+
+static uint32_t sum_ascii_scalar(const uint8_t *data, size_t len) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < len; i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+#ifdef PLIR256_X86_DISPATCH
+/*
+ * PSADBW against zero adds groups of eight bytes into 64-bit lanes, so the
+ * accumulators cannot overflow and the result is the byte sum mod 2^32.
+ */
+__attribute__((target("sse2")))
+static uint32_t sum_ascii_sse2(const uint8_t *data, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(data + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i + 48));
+        acc0 = _mm_add_epi64(acc0, _mm_add_epi64(_mm_sad_epu8(a, zero), _mm_sad_epu8(b, zero)));
+        acc1 = _mm_add_epi64(acc1, _mm_add_epi64(_mm_sad_epu8(c, zero), _mm_sad_epu8(d, zero)));
+    }
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(a, zero));
+    }
+
+    __m128i acc = _mm_add_epi64(acc0, acc1);
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+    return (uint32_t)_mm_cvtsi128_si32(acc) + sum_ascii_scalar(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static uint32_t sum_ascii_avx2(const uint8_t *data, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+    size_t i = 0;
+
+    for (; i + 128 <= len; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(data + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(data + i + 96));
+        acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(_mm256_sad_epu8(a, zero), _mm256_sad_epu8(b, zero)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(_mm256_sad_epu8(c, zero), _mm256_sad_epu8(d, zero)));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(data + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_sad_epu8(a, zero));
+    }
+
+    __m256i acc = _mm256_add_epi64(acc0, acc1);
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_add_epi64(half, _mm_unpackhi_epi64(half, half));
+    return (uint32_t)_mm_cvtsi128_si32(half) + sum_ascii_scalar(data + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static uint32_t sum_ascii_avx512(const uint8_t *data, size_t len) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i acc0 = zero, acc1 = zero;
+    size_t i = 0;
+
+    for (; i + 256 <= len; i += 256) {
+        __m512i a = _mm512_loadu_si512((const void *)(data + i));
+        __m512i b = _mm512_loadu_si512((const void *)(data + i + 64));
+        __m512i c = _mm512_loadu_si512((const void *)(data + i + 128));
+        __m512i d = _mm512_loadu_si512((const void *)(data + i + 192));
+        acc0 = _mm512_add_epi64(acc0, _mm512_add_epi64(_mm512_sad_epu8(a, zero), _mm512_sad_epu8(b, zero)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_add_epi64(_mm512_sad_epu8(c, zero), _mm512_sad_epu8(d, zero)));
+    }
+    for (; i < len; i += 64) {
+        size_t rest = len - i;
+        __mmask64 mask = rest >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << rest) - 1);
+        __m512i a = _mm512_maskz_loadu_epi8(mask, (const void *)(data + i));
+        acc0 = _mm512_add_epi64(acc0, _mm512_sad_epu8(a, zero));
+    }
+
+    return (uint32_t)_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+}
+
+enum { CPU_AUTO = 0, CPU_SCALAR, CPU_SSE2, CPU_AVX2, CPU_AVX512 };
+
+static const char *const cpu_level_names[] = { "auto", "scalar", "sse2", "avx2", "avx512" };
+
+static int selected_level = CPU_AUTO;
+
+static int detected_cpu_level(void) {
+    static int level;
+    int cached = __atomic_load_n(&level, __ATOMIC_RELAXED);
+    if (cached) {
+        return cached;
+    }
+
+    cached = CPU_SCALAR;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        cached = CPU_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        cached = CPU_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        cached = CPU_SSE2;
+    }
+    __atomic_store_n(&level, cached, __ATOMIC_RELAXED);
+    return cached;
+}
+
+static int cpu_level(void) {
+    int level = __atomic_load_n(&selected_level, __ATOMIC_RELAXED);
+    return level ? level : detected_cpu_level();
+}
+
+static inline uint32_t sum_ascii_dispatch(const uint8_t *data, size_t len) {
+    if (len < 64) {
+        return sum_ascii_scalar(data, len);
+    }
+    switch (cpu_level()) {
+    case CPU_AVX512: return sum_ascii_avx512(data, len);
+    case CPU_AVX2:   return sum_ascii_avx2(data, len);
+    case CPU_SSE2:   return sum_ascii_sse2(data, len);
+    }
+    return sum_ascii_scalar(data, len);
+}
+
+int plir256_set_impl(const char *name) {
+    for (int level = CPU_AUTO; level <= CPU_AVX512; level++) {
+        if (strcmp(name, cpu_level_names[level]) == 0) {
+            if (level > detected_cpu_level()) {
+                return -1;
+            }
+            __atomic_store_n(&selected_level, level, __ATOMIC_RELAXED);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *plir256_impl_name(void) {
+    return cpu_level_names[cpu_level()];
+}
+#else
+#define sum_ascii_dispatch sum_ascii_scalar
+
+int plir256_set_impl(const char *name) {
+    return (strcmp(name, "auto") == 0 || strcmp(name, "scalar") == 0) ? 0 : -1;
+}
+
+const char *plir256_impl_name(void) {
+    return "scalar";
+}
+#endif
+
+static inline uint32_t sum_ascii(const uint8_t *data, size_t len) {
+    STATS_BEGIN(t);
+    uint32_t sum = sum_ascii_dispatch(data, len);
+    STATS_END(PLIR256_PHASE_SUM, 1, len, t);
+    return sum;
+}
+
+static uint32_t load_block(const uint8_t *head, uint64_t len, size_t index) {
+    uint8_t chunk[4] = { ' ', ' ', ' ', ' ' };
+    size_t start_idx = index * 4;
+    for (size_t j = 0; j < 4; j++) {
+        if (start_idx + j < len) {
+            chunk[j] = head[start_idx + j];
+        }
+    }
+
+    return (uint32_t)chunk[0]
+         | ((uint32_t)chunk[1] << 8)
+         | ((uint32_t)chunk[2] << 16)
+         | ((uint32_t)chunk[3] << 24);
+}
+
+/*
+ * Computes message[j % message_length] for j = 0, 2, 4, 6 into words[j / 2].
+ * head holds the first PLIR256_HEAD_SIZE bytes of the message (fewer if len is
+ * shorter). Only the seed values up to the highest index read are generated;
+ * later blocks of the full expansion never reach the round loop. Empty input
+ * expands to a single block of padding so there is no modulus by zero.
+ */
+static void expand_message_deterministic(const uint8_t *head, uint64_t len, uint32_t sum,
+                                         uint32_t words[PLIR256_MESSAGE_WORDS]) {
+    uint64_t message_length = len ? (len + 3) / 4 : 1;
+    size_t index[PLIR256_MESSAGE_WORDS];
+    size_t last = 0;
+
+    for (size_t k = 0; k < PLIR256_MESSAGE_WORDS; k++) {
+        index[k] = message_length > 2 * k ? 2 * k : (size_t)((2 * k) % message_length);
+        if (index[k] > last) {
+            last = index[k];
+        }
+    }
+
+    uint32_t seeds[PLIR256_LIVE_BLOCKS];
+    uint32_t seed = sum * 137U;
+    for (size_t i = 0; i <= last; i++) {
+        seeds[i] = seed;
+        seed = rotate_left(seed, 5) ^ (seed * 71U);
+    }
+
+    for (size_t k = 0; k < PLIR256_MESSAGE_WORDS; k++) {
+        words[k] = load_block(head, len, index[k]) ^ (seeds[index[k]] >> index[k]);
+    }
+}
+
+/*
+ * A stage depends on the input only through its byte sum, its length and its
+ * first PLIR256_HEAD_SIZE bytes, which is what lets plir256_ctx stream.
+ */
+static void init_state(uint32_t sum, uint32_t prev_state, uint32_t h[8]) {
+    uint32_t seed = sum * 137U;
+
+    h[0] = (0x86B47C4C ^ seed) ^ prev_state;
+    h[1] = (0xEEDFCBB3 ^ seed) ^ prev_state;
+    h[2] = (0x1105DC08 ^ seed) ^ prev_state;
+    h[3] = (0x21FB8A71 ^ seed) ^ prev_state;
+    h[4] = (0x43B675C9 ^ seed) ^ prev_state;
+    h[5] = (0x75B803D5 ^ seed) ^ prev_state;
+    h[6] = (0x864FAAE8 ^ seed) ^ prev_state;
+    h[7] = (0xD7C261FF ^ seed) ^ prev_state;
+}
+
+#if defined(__GNUC__)
+#define PLIR256_ALWAYS_INLINE inline __attribute__((always_inline))
+#define PLIR256_UNROLL _Pragma("GCC unroll 64")
+#else
+#define PLIR256_ALWAYS_INLINE inline
+#define PLIR256_UNROLL
+#endif
+
+static PLIR256_ALWAYS_INLINE void round_step(uint32_t h[8], const uint32_t message[PLIR256_MESSAGE_WORDS],
+                                             int i) {
+    uint32_t key = GOLDEN_RATIO_CONST
+                 ^ (i * 73U)
+                 ^ (h[i % 8] << (i % 6))
+                 ^ (h[(i + 3) % 8] >> (i % 4))
+                 ^ (h[(i + 5) % 8] << (i % 8));
+
+    for (int j = 0; j < 8; j += 2) {
+        uint32_t prev_xor = h[(j + 1) % 8] ^ h[(j + 3) % 8];
+
+        h[j] = modular_mix(h[j], key)
+             ^ (message[j / 2] + GOLDEN_RATIO_CONST)
+             ^ prev_xor;
+
+        h[j + 1] = modular_mix(h[j + 1], rotate_left(h[j], 13))
+                 ^ (h[(j + 3) % 8] >> 5)
+                 ^ (h[(j + 6) % 8] << 3)
+                 ^ rotate_left(h[(j + 7) % 8], 17)
+                 ^ prev_xor;
+    }
+}
+
+static void stage_rounds_generic(uint32_t h[8], const uint32_t message[PLIR256_MESSAGE_WORDS], int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        round_step(h, message, i);
+    }
+}
+
+/*
+ * Round counts with a fully unrolled kernel. With i constant in every step
+ * the indices, shift counts and round constants fold away and h[] stays in
+ * registers. Other counts use stage_rounds_generic().
+ */
+#define PLIR256_SPECIALIZED_ROUNDS(X) X(8) X(12) X(16) X(32)
+
+#define PLIR256_DEFINE_STAGE_ROUNDS(n)                                                          \
+    static void stage_rounds_##n(uint32_t h[8], const uint32_t message[PLIR256_MESSAGE_WORDS]) { \
+        uint32_t w[8];                                                                          \
+        memcpy(w, h, sizeof(w));                                                                \
+        PLIR256_UNROLL                                                                          \
+        for (int i = 0; i < (n); i++) {                                                         \
+            round_step(w, message, i);                                                          \
+        }                                                                                       \
+        memcpy(h, w, sizeof(w));                                                                \
+    }
+
+PLIR256_SPECIALIZED_ROUNDS(PLIR256_DEFINE_STAGE_ROUNDS)
+
+static void stage_rounds_dispatch(uint32_t h[8], const uint32_t message[PLIR256_MESSAGE_WORDS],
+                                  int rounds) {
+#define PLIR256_STAGE_ROUNDS_CASE(n) case n: stage_rounds_##n(h, message); return;
+    switch (rounds) {
+    PLIR256_SPECIALIZED_ROUNDS(PLIR256_STAGE_ROUNDS_CASE)
+    }
+#undef PLIR256_STAGE_ROUNDS_CASE
+    stage_rounds_generic(h, message, rounds);
+}
+
+static inline void stage_rounds(uint32_t h[8], const uint32_t message[PLIR256_MESSAGE_WORDS],
+                                int rounds) {
+    STATS_BEGIN(t);
+    stage_rounds_dispatch(h, message, rounds);
+    STATS_END(PLIR256_PHASE_ROUNDS, 1, 0, t);
+}
+
+static void words_to_digest(const uint32_t h[8], uint8_t out[PLIR256_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)(h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+static void single_stage_hash(uint32_t sum, const uint8_t *head, uint64_t len,
+                              uint32_t prev_state, int rounds, uint32_t h[8]) {
+    uint32_t message[PLIR256_MESSAGE_WORDS];
+
+    STATS_BEGIN(t);
+    init_state(sum, prev_state, h);
+    expand_message_deterministic(head, len, sum, message);
+    STATS_END(PLIR256_PHASE_EXPAND, 1, 0, t);
+    stage_rounds(h, message, rounds);
+}
+
+/*
+ * Stages after the first hash the previous stage's words written as 64
+ * lowercase hex characters. Rather than formatting and rescanning that text,
+ * derive its byte sum and its expanded message words straight from h[]:
+ * a 64-byte input has 16 blocks, so words 0, 2, 4, 6 are read, and block 2k
+ * holds the first four hex digits (the high half) of h[k].
+ */
+static uint32_t stage_input(const uint32_t h[8], uint32_t words[PLIR256_MESSAGE_WORDS]) {
+    /* Each digit is '0' + n, plus 39 more when n >= 10 ('a' - '0' - 10). */
+    uint32_t nibbles = 0, letters = 0;
+    for (int k = 0; k < 8; k++) {
+        uint32_t lo = h[k] & 0x0F0F0F0FU;
+        uint32_t hi = (h[k] >> 4) & 0x0F0F0F0FU;
+        nibbles += ((lo + hi) * 0x01010101U) >> 24;
+        letters += (((((lo + 0x06060606U) >> 4) & 0x01010101U)
+                   + (((hi + 0x06060606U) >> 4) & 0x01010101U)) * 0x01010101U) >> 24;
+    }
+    uint32_t sum = 64 * '0' + nibbles + 39 * letters;
+
+    uint32_t seed = sum * 137U;
+    for (int i = 0; i < 2 * PLIR256_MESSAGE_WORDS - 1; i++) {
+        if (i % 2 == 0) {
+            uint32_t top = h[i / 2] >> 16;
+            uint32_t block = (uint32_t)(uint8_t)hex_digits[top >> 12]
+                           | ((uint32_t)(uint8_t)hex_digits[(top >> 8) & 0xF] << 8)
+                           | ((uint32_t)(uint8_t)hex_digits[(top >> 4) & 0xF] << 16)
+                           | ((uint32_t)(uint8_t)hex_digits[top & 0xF] << 24);
+            words[i / 2] = block ^ (seed >> i);
+        }
+        seed = rotate_left(seed, 5) ^ (seed * 71U);
+    }
+
+    return sum;
+}
+
+static void finish_stages(uint32_t sum, const uint8_t *head, uint64_t len, int rounds, int stages,
+                          uint8_t out[PLIR256_DIGEST_SIZE]) {
+    uint32_t h[8];
+    uint32_t message[PLIR256_MESSAGE_WORDS];
+    uint32_t state = 0U;
+
+    single_stage_hash(sum, head, len, state, rounds, h);
+    state ^= h[0];
+
+    for (int s = 1; s < stages; s++) {
+        STATS_BEGIN(t);
+        sum = stage_input(h, message);
+        init_state(sum, state, h);
+        STATS_END(PLIR256_PHASE_EXPAND, 1, 0, t);
+        stage_rounds(h, message, rounds);
+        state ^= h[0];
+    }
+
+    words_to_digest(h, out);
+    PLIR256_PROBE3(hash, len, rounds, stages);
+}
+
+void plir256_ex(const uint8_t *data, size_t len, int rounds, int stages,
+                uint8_t out[PLIR256_DIGEST_SIZE]) {
+    finish_stages(sum_ascii(data, len), data, len, rounds, stages, out);
+}
+
+/* Widest lane group (AVX-512); also the keystream batch size on every target. */
+#define PLIR256_MAX_LANES 16
+
+#ifdef PLIR256_X86_DISPATCH
+/*
+ * Multi-buffer hashing: one message per 32-bit vector lane. The state is kept
+ * as h[word][lane] so the per-lane setup between stages stays scalar while the
+ * round loop, where all lanes use the same shift counts, runs on whole vectors.
+ */
+
+typedef void (*lane_rounds_fn)(uint32_t h[8][PLIR256_MAX_LANES],
+                               const uint32_t message[PLIR256_MESSAGE_WORDS][PLIR256_MAX_LANES],
+                               int rounds);
+
+#define ROTL_AVX2(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+__attribute__((target("avx2")))
+static inline __m256i modular_mix_avx2(__m256i x, __m256i y) {
+    __m256i x33 = _mm256_add_epi32(_mm256_slli_epi32(x, 5), x);
+    __m256i y19 = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(y, 4), _mm256_slli_epi32(y, 1)), y);
+    __m256i sum = _mm256_add_epi32(_mm256_add_epi32(y19, ROTL_AVX2(x, 11)),
+                                   _mm256_add_epi32(ROTL_AVX2(y, 15), _mm256_srli_epi32(x, 3)));
+    return _mm256_xor_si256(_mm256_xor_si256(x33, sum), _mm256_slli_epi32(y, 2));
+}
+
+__attribute__((target("avx2")))
+static void lane_rounds_avx2(uint32_t hw[8][PLIR256_MAX_LANES],
+                             const uint32_t message[PLIR256_MESSAGE_WORDS][PLIR256_MAX_LANES],
+                             int rounds) {
+    __m256i h[8], m[PLIR256_MESSAGE_WORDS];
+    const __m256i golden = _mm256_set1_epi32((int)GOLDEN_RATIO_CONST);
+
+    for (int k = 0; k < 8; k++) {
+        h[k] = _mm256_loadu_si256((const __m256i *)hw[k]);
+    }
+    for (int k = 0; k < PLIR256_MESSAGE_WORDS; k++) {
+        m[k] = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)message[k]), golden);
+    }
+
+    for (int i = 0; i < rounds; i++) {
+        __m256i key = _mm256_set1_epi32((int)(GOLDEN_RATIO_CONST ^ (i * 73U)));
+        key = _mm256_xor_si256(key, _mm256_sll_epi32(h[i % 8], _mm_cvtsi32_si128(i % 6)));
+        key = _mm256_xor_si256(key, _mm256_srl_epi32(h[(i + 3) % 8], _mm_cvtsi32_si128(i % 4)));
+        key = _mm256_xor_si256(key, _mm256_sll_epi32(h[(i + 5) % 8], _mm_cvtsi32_si128(i % 8)));
+
+        for (int j = 0; j < 8; j += 2) {
+            __m256i prev_xor = _mm256_xor_si256(h[(j + 1) % 8], h[(j + 3) % 8]);
+
+            h[j] = _mm256_xor_si256(_mm256_xor_si256(modular_mix_avx2(h[j], key), m[j / 2]), prev_xor);
+
+            __m256i t = modular_mix_avx2(h[j + 1], ROTL_AVX2(h[j], 13));
+            t = _mm256_xor_si256(t, _mm256_srli_epi32(h[(j + 3) % 8], 5));
+            t = _mm256_xor_si256(t, _mm256_slli_epi32(h[(j + 6) % 8], 3));
+            t = _mm256_xor_si256(t, ROTL_AVX2(h[(j + 7) % 8], 17));
+            h[j + 1] = _mm256_xor_si256(t, prev_xor);
+        }
+    }
+
+    for (int k = 0; k < 8; k++) {
+        _mm256_storeu_si256((__m256i *)hw[k], h[k]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i modular_mix_avx512(__m512i x, __m512i y) {
+    __m512i x33 = _mm512_add_epi32(_mm512_slli_epi32(x, 5), x);
+    __m512i y19 = _mm512_add_epi32(_mm512_add_epi32(_mm512_slli_epi32(y, 4), _mm512_slli_epi32(y, 1)), y);
+    __m512i sum = _mm512_add_epi32(_mm512_add_epi32(y19, _mm512_rol_epi32(x, 11)),
+                                   _mm512_add_epi32(_mm512_rol_epi32(y, 15), _mm512_srli_epi32(x, 3)));
+    return _mm512_xor_si512(_mm512_xor_si512(x33, sum), _mm512_slli_epi32(y, 2));
+}
+
+__attribute__((target("avx512f")))
+static void lane_rounds_avx512(uint32_t hw[8][PLIR256_MAX_LANES],
+                               const uint32_t message[PLIR256_MESSAGE_WORDS][PLIR256_MAX_LANES],
+                               int rounds) {
+    __m512i h[8], m[PLIR256_MESSAGE_WORDS];
+    const __m512i golden = _mm512_set1_epi32((int)GOLDEN_RATIO_CONST);
+
+    for (int k = 0; k < 8; k++) {
+        h[k] = _mm512_loadu_si512((const void *)hw[k]);
+    }
+    for (int k = 0; k < PLIR256_MESSAGE_WORDS; k++) {
+        m[k] = _mm512_add_epi32(_mm512_loadu_si512((const void *)message[k]), golden);
+    }
+
+    for (int i = 0; i < rounds; i++) {
+        __m512i key = _mm512_set1_epi32((int)(GOLDEN_RATIO_CONST ^ (i * 73U)));
+        key = _mm512_xor_si512(key, _mm512_sll_epi32(h[i % 8], _mm_cvtsi32_si128(i % 6)));
+        key = _mm512_xor_si512(key, _mm512_srl_epi32(h[(i + 3) % 8], _mm_cvtsi32_si128(i % 4)));
+        key = _mm512_xor_si512(key, _mm512_sll_epi32(h[(i + 5) % 8], _mm_cvtsi32_si128(i % 8)));
+
+        for (int j = 0; j < 8; j += 2) {
+            __m512i prev_xor = _mm512_xor_si512(h[(j + 1) % 8], h[(j + 3) % 8]);
+
+            h[j] = _mm512_ternarylogic_epi32(modular_mix_avx512(h[j], key), m[j / 2], prev_xor, 0x96);
+
+            __m512i t = modular_mix_avx512(h[j + 1], _mm512_rol_epi32(h[j], 13));
+            t = _mm512_ternarylogic_epi32(t, _mm512_srli_epi32(h[(j + 3) % 8], 5),
+                                          _mm512_slli_epi32(h[(j + 6) % 8], 3), 0x96);
+            h[j + 1] = _mm512_ternarylogic_epi32(t, _mm512_rol_epi32(h[(j + 7) % 8], 17), prev_xor, 0x96);
+        }
+    }
+
+    for (int k = 0; k < 8; k++) {
+        _mm512_storeu_si512((void *)hw[k], h[k]);
+    }
+}
+
+static void lane_stage_setup(uint32_t h[8][PLIR256_MAX_LANES],
+                             uint32_t message[PLIR256_MESSAGE_WORDS][PLIR256_MAX_LANES],
+                             size_t lane, uint32_t sum, const uint32_t words[PLIR256_MESSAGE_WORDS],
+                             uint32_t prev_state) {
+    uint32_t hl[8];
+
+    init_state(sum, prev_state, hl);
+    for (int k = 0; k < 8; k++) {
+        h[k][lane] = hl[k];
+    }
+    for (int k = 0; k < PLIR256_MESSAGE_WORDS; k++) {
+        message[k][lane] = words[k];
+    }
+}
+
+/* With a key context, each lane hashes the absorbed key followed by msgs[l]. */
+static void hash_lanes(const plir256_ctx *key, const uint8_t *const *msgs, const size_t *lens,
+                       size_t lanes, uint8_t (*out)[PLIR256_DIGEST_SIZE], int rounds, int stages,
+                       lane_rounds_fn kernel) {
+    uint32_t h[8][PLIR256_MAX_LANES];
+    uint32_t message[PLIR256_MESSAGE_WORDS][PLIR256_MAX_LANES];
+    uint32_t state[PLIR256_MAX_LANES];
+    uint32_t words[PLIR256_MESSAGE_WORDS];
+
+    for (size_t l = 0; l < lanes; l++) {
+        uint32_t sum = sum_ascii(msgs[l], lens[l]);
+        STATS_BEGIN(t);
+        state[l] = 0U;
+        if (key) {
+            plir256_ctx ctx = *key;
+            if (ctx.len < PLIR256_HEAD_SIZE) {
+                size_t take = PLIR256_HEAD_SIZE - (size_t)ctx.len;
+                memcpy(ctx.head + ctx.len, msgs[l], take < lens[l] ? take : lens[l]);
+            }
+            sum += ctx.sum;
+            expand_message_deterministic(ctx.head, ctx.len + lens[l], sum, words);
+        } else {
+            expand_message_deterministic(msgs[l], lens[l], sum, words);
+        }
+        lane_stage_setup(h, message, l, sum, words, state[l]);
+        STATS_END(PLIR256_PHASE_EXPAND, 1, 0, t);
+    }
+    STATS_BEGIN(t);
+    kernel(h, message, rounds);
+    STATS_END(PLIR256_PHASE_ROUNDS, lanes, 0, t);
+
+    for (int s = 1; s < stages; s++) {
+        STATS_BEGIN(t1);
+        for (size_t l = 0; l < lanes; l++) {
+            uint32_t hl[8];
+            for (int k = 0; k < 8; k++) {
+                hl[k] = h[k][l];
+            }
+            state[l] ^= hl[0];
+            uint32_t sum = stage_input(hl, words);
+            lane_stage_setup(h, message, l, sum, words, state[l]);
+        }
+        STATS_END(PLIR256_PHASE_EXPAND, lanes, 0, t1);
+        STATS_BEGIN(t2);
+        kernel(h, message, rounds);
+        STATS_END(PLIR256_PHASE_ROUNDS, lanes, 0, t2);
+    }
+
+    for (size_t l = 0; l < lanes; l++) {
+        uint32_t hl[8];
+        for (int k = 0; k < 8; k++) {
+            hl[k] = h[k][l];
+        }
+        words_to_digest(hl, out[l]);
+    }
+}
+#endif
+
+static void hash_batch(const plir256_ctx *key, const uint8_t *const *msgs, const size_t *lens,
+                       size_t n, uint8_t (*out)[PLIR256_DIGEST_SIZE], int rounds, int stages) {
+    size_t i = 0;
+
+#ifdef PLIR256_X86_DISPATCH
+    lane_rounds_fn kernel = NULL;
+    size_t lanes = 0;
+
+    switch (cpu_level()) {
+    case CPU_AVX512: kernel = lane_rounds_avx512; lanes = 16; break;
+    case CPU_AVX2:   kernel = lane_rounds_avx2;   lanes = 8;  break;
+    }
+    if (kernel) {
+        for (; i + lanes <= n; i += lanes) {
+            hash_lanes(key, msgs + i, lens + i, lanes, out + i, rounds, stages, kernel);
+        }
+    }
+#endif
+
+    PLIR256_PROBE3(batch, n, rounds, stages);
+    for (; i < n; i++) {
+        if (key) {
+            plir256_keyed(key, msgs[i], lens[i], out[i]);
+        } else {
+            plir256_ex(msgs[i], lens[i], rounds, stages, out[i]);
+        }
+    }
+}
+
+void plir256_hash_batch(const uint8_t *const *msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[PLIR256_DIGEST_SIZE], int rounds, int stages) {
+    hash_batch(NULL, msgs, lens, n, out, rounds, stages);
+}
+
+void plir256(const uint8_t *data, size_t len, uint8_t out[PLIR256_DIGEST_SIZE]) {
+    plir256_ex(data, len, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES, out);
+}
+
+void plir256_init(plir256_ctx *ctx) {
+    plir256_init_ex(ctx, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES);
+}
+
+void plir256_init_ex(plir256_ctx *ctx, int rounds, int stages) {
+    ctx->sum = 0;
+    ctx->len = 0;
+    ctx->rounds = rounds;
+    ctx->stages = stages;
+}
+
+void plir256_update(plir256_ctx *ctx, const uint8_t *data, size_t len) {
+    if (ctx->len < PLIR256_HEAD_SIZE) {
+        size_t take = PLIR256_HEAD_SIZE - (size_t)ctx->len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(ctx->head + ctx->len, data, take);
+    }
+    ctx->sum += sum_ascii(data, len);
+    ctx->len += len;
+}
+
+void plir256_final(plir256_ctx *ctx, uint8_t out[PLIR256_DIGEST_SIZE]) {
+    finish_stages(ctx->sum, ctx->head, ctx->len, ctx->rounds, ctx->stages, out);
+}
+
+void plir256_keyed_init(plir256_ctx *key_ctx, const uint8_t *key, size_t key_len,
+                        int rounds, int stages) {
+    plir256_init_ex(key_ctx, rounds, stages);
+    plir256_update(key_ctx, key, key_len);
+}
+
+void plir256_keyed(const plir256_ctx *key_ctx, const uint8_t *msg, size_t len,
+                   uint8_t out[PLIR256_DIGEST_SIZE]) {
+    plir256_ctx ctx = *key_ctx;
+    plir256_update(&ctx, msg, len);
+    plir256_final(&ctx, out);
+}
+
+void plir256_keyed_batch(const plir256_ctx *key_ctx, const uint8_t *const *msgs, const size_t *lens,
+                         size_t n, uint8_t (*out)[PLIR256_DIGEST_SIZE]) {
+    hash_batch(key_ctx, msgs, lens, n, out, key_ctx->rounds, key_ctx->stages);
+}
+
+static void store_le64(uint8_t out[8], uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+void plir256_tree_leaf(uint64_t index, const uint8_t *chunk, size_t len, int rounds, int stages,
+                       uint8_t out[PLIR256_DIGEST_SIZE]) {
+    uint8_t prefix[9];
+    plir256_ctx ctx;
+
+    prefix[0] = 'L';
+    store_le64(prefix + 1, index);
+    plir256_init_ex(&ctx, rounds, stages);
+    plir256_update(&ctx, prefix, sizeof(prefix));
+    plir256_update(&ctx, chunk, len);
+    plir256_final(&ctx, out);
+}
+
+void plir256_tree_init(plir256_ctx *root, int rounds, int stages) {
+    uint8_t header[12] = { 'P', 'L', 'I', 'R', '2', '5', '6', 'T' };
+
+    header[8] = (uint8_t)PLIR256_TREE_VERSION;
+    header[9] = (uint8_t)(PLIR256_TREE_LEAF_SIZE >> 16);
+    header[10] = (uint8_t)(PLIR256_TREE_LEAF_SIZE >> 8);
+    header[11] = (uint8_t)PLIR256_TREE_LEAF_SIZE;
+    plir256_init_ex(root, rounds, stages);
+    plir256_update(root, header, sizeof(header));
+}
+
+void plir256_tree_add_leaf(plir256_ctx *root, const uint8_t leaf[PLIR256_DIGEST_SIZE]) {
+    plir256_update(root, leaf, PLIR256_DIGEST_SIZE);
+}
+
+void plir256_tree_final(plir256_ctx *root, uint64_t total_len, uint8_t out[PLIR256_DIGEST_SIZE]) {
+    uint8_t trailer[8];
+
+    store_le64(trailer, total_len);
+    plir256_update(root, trailer, sizeof(trailer));
+    plir256_final(root, out);
+}
+
+void plir256_tree(const uint8_t *data, size_t len, int rounds, int stages,
+                  uint8_t out[PLIR256_DIGEST_SIZE]) {
+    plir256_ctx root;
+    uint8_t leaf[PLIR256_DIGEST_SIZE];
+    uint64_t leaves = plir256_tree_leaf_count(len);
+
+    plir256_tree_init(&root, rounds, stages);
+    for (uint64_t i = 0; i < leaves; i++) {
+        size_t off = (size_t)i * PLIR256_TREE_LEAF_SIZE;
+        size_t n = len - off < PLIR256_TREE_LEAF_SIZE ? len - off : PLIR256_TREE_LEAF_SIZE;
+        plir256_tree_leaf(i, data + off, n, rounds, stages, leaf);
+        plir256_tree_add_leaf(&root, leaf);
+    }
+    plir256_tree_final(&root, len, out);
+}
+
+void plir256_kdf(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len,
+                 uint32_t iterations, uint8_t out[PLIR256_DIGEST_SIZE]) {
+    plir256_ctx ctx;
+    plir256_init(&ctx);
+    plir256_update(&ctx, password, password_len);
+    plir256_update(&ctx, salt, salt_len);
+    plir256_final(&ctx, out);
+
+    for (uint32_t i = 1; i < iterations; i++) {
+        plir256_init(&ctx);
+        plir256_update(&ctx, out, PLIR256_DIGEST_SIZE);
+        plir256_update(&ctx, password, password_len);
+        plir256_update(&ctx, salt, salt_len);
+        plir256_final(&ctx, out);
+    }
+}
+
+void plir256_keystream(const uint8_t key[PLIR256_DIGEST_SIZE], uint64_t counter,
+                       uint8_t *out, size_t len) {
+    uint8_t blocks[PLIR256_MAX_LANES][8 + PLIR256_DIGEST_SIZE];
+    const uint8_t *msgs[PLIR256_MAX_LANES];
+    size_t lens[PLIR256_MAX_LANES];
+    uint8_t digests[PLIR256_MAX_LANES][PLIR256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < PLIR256_MAX_LANES; i++) {
+        memcpy(blocks[i] + 8, key, PLIR256_DIGEST_SIZE);
+        msgs[i] = blocks[i];
+        lens[i] = sizeof(blocks[i]);
+    }
+
+    while (len > 0) {
+        size_t n = (len + PLIR256_DIGEST_SIZE - 1) / PLIR256_DIGEST_SIZE;
+        if (n > PLIR256_MAX_LANES) {
+            n = PLIR256_MAX_LANES;
+        }
+        for (size_t i = 0; i < n; i++) {
+            store_le64(blocks[i], counter++);
+        }
+        plir256_hash_batch(msgs, lens, n, digests, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES);
+
+        size_t take = n * PLIR256_DIGEST_SIZE < len ? n * PLIR256_DIGEST_SIZE : len;
+        memcpy(out, digests, take);
+        out += take;
+        len -= take;
+    }
+}
+
+void plir256_to_hex(const uint8_t digest[PLIR256_DIGEST_SIZE], char out_hex[PLIR256_HEX_SIZE]) {
+    STATS_BEGIN(t);
+    for (int i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+        out_hex[2 * i]     = hex_digits[digest[i] >> 4];
+        out_hex[2 * i + 1] = hex_digits[digest[i] & 0x0F];
+    }
+    out_hex[64] = '\0';
+    STATS_END(PLIR256_PHASE_HEX, 1, PLIR256_HEX_SIZE - 1, t);
+}
+
+int plir256_stats(plir256_phase_stats out[PLIR256_PHASE_COUNT]) {
+    memset(out, 0, PLIR256_PHASE_COUNT * sizeof(plir256_phase_stats));
+#ifdef PLIR256_STATS
+    unsigned used = __atomic_load_n(&stats_slots_used, __ATOMIC_RELAXED);
+    for (unsigned i = 0; i < used && i < PLIR256_STATS_SLOTS; i++) {
+        for (int p = 0; p < PLIR256_PHASE_COUNT; p++) {
+            const plir256_phase_stats *src = &stats_slots[i].phase[p];
+            out[p].calls  += __atomic_load_n(&src->calls, __ATOMIC_RELAXED);
+            out[p].bytes  += __atomic_load_n(&src->bytes, __ATOMIC_RELAXED);
+            out[p].cycles += __atomic_load_n(&src->cycles, __ATOMIC_RELAXED);
+        }
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void plir256_stats_reset(void) {
+#ifdef PLIR256_STATS
+    for (unsigned i = 0; i < PLIR256_STATS_SLOTS; i++) {
+        for (int p = 0; p < PLIR256_PHASE_COUNT; p++) {
+            plir256_phase_stats *dst = &stats_slots[i].phase[p];
+            __atomic_store_n(&dst->calls, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&dst->bytes, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&dst->cycles, 0, __ATOMIC_RELAXED);
+        }
+    }
+#endif
+}
+
+const char *plir256_phase_name(int phase) {
+    static const char *const names[PLIR256_PHASE_COUNT] = { "sum", "expand", "rounds", "hex" };
+    return phase >= 0 && phase < PLIR256_PHASE_COUNT ? names[phase] : "unknown";
+}
+
+void secure_plir_256(const char *text, int rounds, int stages, char *out_hex) {
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256_ex((const uint8_t *)text, strlen(text), rounds, stages, digest);
+    plir256_to_hex(digest, out_hex);
+}
+
+int constant_time_compare(const char *val1, const char *val2) {
+    size_t len1 = strlen(val1);
+    size_t len2 = strlen(val2);
+
+    if (len1 != len2) {
+        return 0;
+    }
+
+    unsigned char result = 0;
+    for (size_t i = 0; i < len1; i++) {
+        result |= (val1[i] ^ val2[i]);
+    }
+    return (result == 0);
+}
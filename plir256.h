@@ -0,0 +1,167 @@
+#ifndef PLIR256_H
+#define PLIR256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLIR256_DIGEST_SIZE     32
+#define PLIR256_HEX_SIZE        65
+
+#define PLIR256_DEFAULT_ROUNDS  8
+#define PLIR256_DEFAULT_STAGES  2
+
+/* Leading input bytes that reach the message blocks read by the round loop. */
+#define PLIR256_HEAD_SIZE       28
+
+/*
+ * Incremental hashing state. Apart from the first PLIR256_HEAD_SIZE bytes the
+ * digest depends only on the byte sum and the length of the input, so the
+ * context is a few dozen bytes whatever the input size.
+ */
+typedef struct {
+    uint32_t sum;
+    uint64_t len;
+    uint8_t  head[PLIR256_HEAD_SIZE];
+    int      rounds;
+    int      stages;
+} plir256_ctx;
+
+/*
+ * Hashes len bytes at data with the default 8 rounds / 2 stages.
+ * The input may contain NUL bytes; nothing is allocated.
+ */
+void plir256(const uint8_t *data, size_t len, uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/* Same as plir256() with explicit rounds and stages (stages < 1 runs one stage). */
+void plir256_ex(const uint8_t *data, size_t len, int rounds, int stages,
+                uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/*
+ * Hashes n independent messages, writing the digest of msgs[i] to out[i].
+ * Full groups of 8 (AVX2) or 16 (AVX-512) messages are hashed in parallel
+ * vector lanes; the output is identical to calling plir256_ex() per message.
+ */
+void plir256_hash_batch(const uint8_t *const *msgs, const size_t *lens, size_t n,
+                        uint8_t (*out)[PLIR256_DIGEST_SIZE], int rounds, int stages);
+
+/* Streaming interface; the digest equals plir256_ex() over the concatenated input. */
+void plir256_init(plir256_ctx *ctx);
+void plir256_init_ex(plir256_ctx *ctx, int rounds, int stages);
+void plir256_update(plir256_ctx *ctx, const uint8_t *data, size_t len);
+void plir256_final(plir256_ctx *ctx, uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/*
+ * Keyed mode for hashing many messages as key || message. The key is absorbed
+ * once into key_ctx, which is never modified afterwards: plir256_keyed() and
+ * plir256_keyed_batch() work on a copy, so one key context can serve any
+ * number of threads. Digests equal plir256_ex() over key || message.
+ */
+void plir256_keyed_init(plir256_ctx *key_ctx, const uint8_t *key, size_t key_len,
+                        int rounds, int stages);
+void plir256_keyed(const plir256_ctx *key_ctx, const uint8_t *msg, size_t len,
+                   uint8_t out[PLIR256_DIGEST_SIZE]);
+void plir256_keyed_batch(const plir256_ctx *key_ctx, const uint8_t *const *msgs, const size_t *lens,
+                         size_t n, uint8_t (*out)[PLIR256_DIGEST_SIZE]);
+
+/*
+ * PLIR-256 tree mode, version 1. The input is split into PLIR256_TREE_LEAF_SIZE
+ * chunks (the last may be shorter; empty input has one empty leaf). Leaf i is
+ * PLIR-256 of 'L' || le64(i) || chunk. The root is PLIR-256 of the 12-byte
+ * header "PLIR256T" || version || be24(leaf size), every leaf digest in order,
+ * and le64(total length). Leaves are independent, so callers can hash them on
+ * any number of threads, or re-check a single chunk. Tree digests differ from
+ * plain plir256_ex() digests.
+ */
+#define PLIR256_TREE_VERSION    1
+#define PLIR256_TREE_LEAF_SIZE  (1024 * 1024)
+
+static inline uint64_t plir256_tree_leaf_count(uint64_t total_len) {
+    return total_len ? (total_len + PLIR256_TREE_LEAF_SIZE - 1) / PLIR256_TREE_LEAF_SIZE : 1;
+}
+
+void plir256_tree_leaf(uint64_t index, const uint8_t *chunk, size_t len, int rounds, int stages,
+                       uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/* Root accumulation: init, add each leaf in order, then final with the input length. */
+void plir256_tree_init(plir256_ctx *root, int rounds, int stages);
+void plir256_tree_add_leaf(plir256_ctx *root, const uint8_t leaf[PLIR256_DIGEST_SIZE]);
+void plir256_tree_final(plir256_ctx *root, uint64_t total_len, uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/* Single-threaded tree digest of a whole buffer. */
+void plir256_tree(const uint8_t *data, size_t len, int rounds, int stages,
+                  uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/*
+ * Salted, iterated password hash. The first iteration is PLIR-256 of
+ * password || salt, the same digest as the README's `echo "$PASSWORD$SALT" |
+ * plirsum`; each further one hashes the previous binary digest || password ||
+ * salt. iterations < 1 runs one iteration.
+ *
+ * In an ITER + SALT + HASH record ITER is the leading run of digits, so the
+ * salt must not start with a digit, and record readers reject ITER above
+ * PLIR256_KDF_MAX_ITERATIONS (about 30 ms of work).
+ */
+#define PLIR256_KDF_MAX_ITERATIONS 100000
+
+void plir256_kdf(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t salt_len,
+                 uint32_t iterations, uint8_t out[PLIR256_DIGEST_SIZE]);
+
+/*
+ * Counter-mode keystream: block i is PLIR-256 of le64(counter + i) || key,
+ * and len bytes of consecutive blocks are written to out. Blocks are hashed
+ * in batches, so long streams run on the vector lanes. The key should come
+ * from the operating system's random source.
+ */
+void plir256_keystream(const uint8_t key[PLIR256_DIGEST_SIZE], uint64_t counter,
+                       uint8_t *out, size_t len);
+
+/* Writes the 64 lowercase hex characters of digest plus a terminating NUL. */
+void plir256_to_hex(const uint8_t digest[PLIR256_DIGEST_SIZE], char out_hex[PLIR256_HEX_SIZE]);
+
+/*
+ * Kernel selection, mainly for benchmarks and debugging: "auto" (the default,
+ * best available), "scalar", "sse2", "avx2" or "avx512". Returns 0, or -1 if
+ * the name is unknown or the CPU lacks the instructions. Process-wide.
+ */
+int plir256_set_impl(const char *name);
+const char *plir256_impl_name(void);
+
+/*
+ * Per-phase counters: byte-sum scans, stage setup (state init and message
+ * expansion), round loops (calls count hashes, one per vector lane) and hex
+ * formatting. Only counted when the library is built with -DPLIR256_STATS
+ * (make STATS=1); otherwise plir256_stats() zeroes out and returns -1.
+ * Cycles are TSC ticks on x86, nanoseconds elsewhere.
+ */
+enum {
+    PLIR256_PHASE_SUM,
+    PLIR256_PHASE_EXPAND,
+    PLIR256_PHASE_ROUNDS,
+    PLIR256_PHASE_HEX,
+    PLIR256_PHASE_COUNT
+};
+
+typedef struct {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t cycles;
+} plir256_phase_stats;
+
+int plir256_stats(plir256_phase_stats out[PLIR256_PHASE_COUNT]);
+void plir256_stats_reset(void);
+const char *plir256_phase_name(int phase);
+
+/* NUL-terminated string interface kept for existing callers. */
+void secure_plir_256(const char *text, int rounds, int stages, char *out_hex);
+
+int constant_time_compare(const char *val1, const char *val2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdint.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "plir256.h"
+
+/* Below this many messages per thread, extra threads cost more than they save. */
+#define HASH_MANY_MIN_PER_THREAD 4096
+#define HASH_MANY_MAX_THREADS    64
+
+static PyObject *plir256_secure_plir_256(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = { "data", "rounds", "stages", NULL };
+    Py_buffer data;
+    int rounds = PLIR256_DEFAULT_ROUNDS, stages = PLIR256_DEFAULT_STAGES;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s*|ii:secure_plir_256", keywords,
+                                     &data, &rounds, &stages)) {
+        return NULL;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    char hex[PLIR256_HEX_SIZE];
+    if (data.len >= 64 * 1024) {
+        Py_BEGIN_ALLOW_THREADS
+        plir256_ex((const uint8_t *)data.buf, (size_t)data.len, rounds, stages, digest);
+        Py_END_ALLOW_THREADS
+    } else {
+        plir256_ex((const uint8_t *)data.buf, (size_t)data.len, rounds, stages, digest);
+    }
+    PyBuffer_Release(&data);
+
+    plir256_to_hex(digest, hex);
+    return PyUnicode_FromStringAndSize(hex, PLIR256_HEX_SIZE - 1);
+}
+
+typedef struct {
+    const uint8_t **msgs;
+    size_t *lens;
+    uint8_t (*out)[PLIR256_DIGEST_SIZE];
+    size_t n;
+    int rounds;
+    int stages;
+} hash_range;
+
+#ifndef _WIN32
+static void *hash_range_worker(void *arg)
+{
+    hash_range *r = (hash_range *)arg;
+    plir256_hash_batch(r->msgs, r->lens, r->n, r->out, r->rounds, r->stages);
+    return NULL;
+}
+#endif
+
+/* Splits the batch over up to `threads` threads; the calling thread takes the first part. */
+static void hash_all(const uint8_t **msgs, size_t *lens, size_t n,
+                     uint8_t (*out)[PLIR256_DIGEST_SIZE], int rounds, int stages, int threads)
+{
+#ifndef _WIN32
+    size_t workers = threads > 0 ? (size_t)threads : 1;
+    if (workers > n / HASH_MANY_MIN_PER_THREAD) {
+        workers = n / HASH_MANY_MIN_PER_THREAD;
+    }
+    if (workers > HASH_MANY_MAX_THREADS) {
+        workers = HASH_MANY_MAX_THREADS;
+    }
+    if (workers > 1) {
+        hash_range ranges[HASH_MANY_MAX_THREADS];
+        pthread_t tids[HASH_MANY_MAX_THREADS];
+        int started[HASH_MANY_MAX_THREADS];
+        size_t per = n / workers;
+
+        for (size_t t = 0; t < workers; t++) {
+            size_t begin = t * per;
+            ranges[t].msgs = msgs + begin;
+            ranges[t].lens = lens + begin;
+            ranges[t].out = out + begin;
+            ranges[t].n = t + 1 == workers ? n - begin : per;
+            ranges[t].rounds = rounds;
+            ranges[t].stages = stages;
+            started[t] = t > 0 && pthread_create(&tids[t], NULL, hash_range_worker, &ranges[t]) == 0;
+        }
+        hash_range_worker(&ranges[0]);
+        for (size_t t = 1; t < workers; t++) {
+            if (started[t]) {
+                pthread_join(tids[t], NULL);
+            } else {
+                hash_range_worker(&ranges[t]);
+            }
+        }
+        return;
+    }
+#endif
+    plir256_hash_batch(msgs, lens, n, out, rounds, stages);
+}
+
+static int default_threads(void)
+{
+#ifndef _WIN32
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#else
+    return 1;
+#endif
+}
+
+/*
+ * hash_many(iterable, rounds=8, stages=2, threads=0) -> list of hex digests.
+ * Items must be bytes or str (hashed as UTF-8). They are hashed from a tuple
+ * snapshot holding a reference to each, so their buffers stay valid while the
+ * GIL is released even if another thread changes the caller's list.
+ */
+static PyObject *plir256_hash_many(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = { "items", "rounds", "stages", "threads", NULL };
+    PyObject *iterable;
+    int rounds = PLIR256_DEFAULT_ROUNDS, stages = PLIR256_DEFAULT_STAGES, threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iii:hash_many", keywords,
+                                     &iterable, &rounds, &stages, &threads)) {
+        return NULL;
+    }
+
+    PyObject *seq = PySequence_Tuple(iterable);
+    if (!seq) {
+        return NULL;
+    }
+    Py_ssize_t n = PyTuple_GET_SIZE(seq);
+
+    const uint8_t **msgs = (const uint8_t **)PyMem_Malloc((size_t)(n ? n : 1) * sizeof(*msgs));
+    size_t *lens = (size_t *)PyMem_Malloc((size_t)(n ? n : 1) * sizeof(*lens));
+    uint8_t (*out)[PLIR256_DIGEST_SIZE] =
+        (uint8_t (*)[PLIR256_DIGEST_SIZE])PyMem_Malloc((size_t)(n ? n : 1) * PLIR256_DIGEST_SIZE);
+    PyObject *result = NULL;
+    if (!msgs || !lens || !out) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = PyTuple_GET_ITEM(seq, i);
+        if (PyBytes_Check(item)) {
+            msgs[i] = (const uint8_t *)PyBytes_AS_STRING(item);
+            lens[i] = (size_t)PyBytes_GET_SIZE(item);
+        } else if (PyUnicode_Check(item)) {
+            Py_ssize_t len;
+            const char *utf8 = PyUnicode_AsUTF8AndSize(item, &len);
+            if (!utf8) {
+                goto done;
+            }
+            msgs[i] = (const uint8_t *)utf8;
+            lens[i] = (size_t)len;
+        } else {
+            PyErr_Format(PyExc_TypeError, "hash_many() items must be bytes or str, not %.100s",
+                         Py_TYPE(item)->tp_name);
+            goto done;
+        }
+    }
+
+    if (threads <= 0) {
+        threads = default_threads();
+    }
+    Py_BEGIN_ALLOW_THREADS
+    hash_all(msgs, lens, (size_t)n, out, rounds, stages, threads);
+    Py_END_ALLOW_THREADS
+
+    result = PyList_New(n);
+    if (!result) {
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        char hex[PLIR256_HEX_SIZE];
+        plir256_to_hex(out[i], hex);
+        PyObject *s = PyUnicode_FromStringAndSize(hex, PLIR256_HEX_SIZE - 1);
+        if (!s) {
+            Py_CLEAR(result);
+            goto done;
+        }
+        PyList_SET_ITEM(result, i, s);
+    }
+
+done:
+    PyMem_Free(msgs);
+    PyMem_Free(lens);
+    PyMem_Free(out);
+    Py_DECREF(seq);
+    return result;
+}
+
+static PyMethodDef plir256_methods[] = {
+    { "secure_plir_256", (PyCFunction)(void (*)(void))plir256_secure_plir_256, METH_VARARGS | METH_KEYWORDS,
+      "secure_plir_256(data, rounds=8, stages=2) -> str\n\n"
+      "Hex PLIR-256 digest of bytes-like data, or of a str encoded as UTF-8." },
+    { "hash_many", (PyCFunction)(void (*)(void))plir256_hash_many, METH_VARARGS | METH_KEYWORDS,
+      "hash_many(items, rounds=8, stages=2, threads=0) -> list of str\n\n"
+      "Hex digests of every bytes or str item, hashed in vector batches on up\n"
+      "to `threads` threads (0: online CPUs) with the GIL released." },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef plir256_module = {
+    PyModuleDef_HEAD_INIT,
+    "plir256",
+    "PLIR-256 hashing on the C core (libplir256).",
+    -1,
+    plir256_methods
+};
+
+PyMODINIT_FUNC PyInit_plir256(void)
+{
+    return PyModule_Create(&plir256_module);
+}
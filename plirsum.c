@@ -2,219 +2,2449 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
 #endif
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+#if defined(__linux__) && !defined(PLIRSUM_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "plir256.h"
+
+uint64_t get_nanotime() {
+    #ifdef _WIN32
+        LARGE_INTEGER freq, counter;
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&counter);
+        uint64_t nanosec = (counter.QuadPart * 1000000000ULL) / freq.QuadPart;
+        return nanosec ^ ((uint64_t)GetTickCount() * 157U);
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    #endif
+}
+
+#define READ_CHUNK_SIZE (256 * 1024)
+
+/*
+ * --stats: plirsum's own counters next to the library's phases, compiled in
+ * with the same -DPLIR256_STATS (make STATS=1). read counts fread() calls and
+ * io_uring reads with the time spent waiting for them; mapped files count one
+ * call each and are paged in during the sum phase. alloc counts buffer
+ * allocations on the hashing paths.
+ */
+#ifdef PLIR256_STATS
+static plir256_phase_stats read_stats;
+static uint64_t alloc_count;
+
+#define READ_BEGIN(t)               uint64_t t = get_nanotime()
+#define READ_END(bytes, t)          count_read(1, bytes, get_nanotime() - t)
+#define READ_WAIT_END(t)            count_read(0, 0, get_nanotime() - t)
+#define COUNT_READ(bytes)           count_read(1, bytes, 0)
+#define COUNT_ALLOC()               __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED)
+
+static void count_read(uint64_t calls, uint64_t bytes, uint64_t ns) {
+    __atomic_fetch_add(&read_stats.calls, calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&read_stats.bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&read_stats.cycles, ns, __ATOMIC_RELAXED);
+}
+#else
+#define READ_BEGIN(t)               ((void)0)
+#define READ_END(bytes, t)          ((void)0)
+#define READ_WAIT_END(t)            ((void)0)
+#define COUNT_READ(bytes)           ((void)0)
+#define COUNT_ALLOC()               ((void)0)
+#endif
+
+/* Returns 0, or an errno value on failure. */
+int hash_stream(FILE *fp, char *out_hash) {
+    uint8_t *buffer = (uint8_t*)malloc(READ_CHUNK_SIZE);
+    if (!buffer) {
+        return ENOMEM;
+    }
+    COUNT_ALLOC();
+
+    plir256_ctx ctx;
+    plir256_init(&ctx);
+
+    for (;;) {
+        READ_BEGIN(t);
+        size_t read_bytes = fread(buffer, 1, READ_CHUNK_SIZE, fp);
+        READ_END(read_bytes, t);
+        if (read_bytes == 0) {
+            break;
+        }
+        plir256_update(&ctx, buffer, read_bytes);
+    }
+    free(buffer);
+    if (ferror(fp)) {
+        return errno ? errno : EIO;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256_final(&ctx, digest);
+    plir256_to_hex(digest, out_hash);
+    return 0;
+}
+
+#ifndef _WIN32
+/*
+ * Maps a regular file for reading. Returns -1 when the file cannot be mapped
+ * (pipes, devices, empty files) so the caller can fall back to buffered reads.
+ */
+int map_file(FILE *fp, const uint8_t **data, size_t *size) {
+    struct stat st;
+    int fd = fileno(fp);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0
+        || (uint64_t)st.st_size > SIZE_MAX) {
+        return -1;
+    }
+
+    READ_BEGIN(t);
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    READ_END((uint64_t)st.st_size, t);
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+
+    *data = (const uint8_t *)map;
+    *size = (size_t)st.st_size;
+    return 0;
+}
+
+/* Hashes a regular file straight out of the page cache. */
+int hash_mapped(FILE *fp, char *out_hash) {
+    const uint8_t *data;
+    size_t size;
+    if (map_file(fp, &data, &size) != 0) {
+        return -1;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256(data, size, digest);
+    plir256_to_hex(digest, out_hash);
+
+    munmap((void *)data, size);
+    return 0;
+}
+#endif
+
+/* --tree: hash in PLIR-256 tree mode, spreading one file's leaves over tree_threads. */
+static int tree_mode = 0;
+static int tree_threads = 1;
+static int recursive = 0;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint64_t count;
+    uint64_t next;
+    uint8_t (*leaves)[PLIR256_DIGEST_SIZE];
+} leaf_queue;
+
+#ifndef _WIN32
+static void *leaf_worker(void *arg) {
+    leaf_queue *q = (leaf_queue*)arg;
+    for (;;) {
+        uint64_t i = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+        if (i >= q->count) {
+            return NULL;
+        }
+        size_t off = (size_t)i * PLIR256_TREE_LEAF_SIZE;
+        size_t n = q->size - off < PLIR256_TREE_LEAF_SIZE ? q->size - off : PLIR256_TREE_LEAF_SIZE;
+        plir256_tree_leaf(i, q->data + off, n, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES, q->leaves[i]);
+    }
+}
+#endif
+
+static void hash_tree_buffer(const uint8_t *data, size_t size, uint8_t digest[PLIR256_DIGEST_SIZE]) {
+    leaf_queue q = { data, size, plir256_tree_leaf_count(size), 0, NULL };
+    size_t workers = tree_threads > 1 ? (size_t)tree_threads : 1;
+    if (workers > q.count) {
+        workers = (size_t)q.count;
+    }
+
+#ifndef _WIN32
+    pthread_t *tids = NULL;
+    if (workers > 1) {
+        q.leaves = (uint8_t (*)[PLIR256_DIGEST_SIZE])malloc((size_t)q.count * PLIR256_DIGEST_SIZE);
+        tids = (pthread_t*)malloc(workers * sizeof(pthread_t));
+        COUNT_ALLOC();
+        COUNT_ALLOC();
+    }
+    if (q.leaves && tids) {
+        size_t started = 0;
+        while (started + 1 < workers && pthread_create(&tids[started], NULL, leaf_worker, &q) == 0) {
+            started++;
+        }
+        leaf_worker(&q);
+        for (size_t t = 0; t < started; t++) {
+            pthread_join(tids[t], NULL);
+        }
+
+        plir256_ctx root;
+        plir256_tree_init(&root, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES);
+        for (uint64_t i = 0; i < q.count; i++) {
+            plir256_tree_add_leaf(&root, q.leaves[i]);
+        }
+        plir256_tree_final(&root, size, digest);
+        free(tids);
+        free(q.leaves);
+        return;
+    }
+    free(tids);
+    free(q.leaves);
+#endif
+
+    plir256_tree(data, size, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES, digest);
+}
+
+/* Returns 0, or an errno value on failure. */
+int hash_tree_stream(FILE *fp, char *out_hash) {
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+
+#ifndef _WIN32
+    const uint8_t *data;
+    size_t size;
+    if (map_file(fp, &data, &size) == 0) {
+        hash_tree_buffer(data, size, digest);
+        munmap((void *)data, size);
+        plir256_to_hex(digest, out_hash);
+        return 0;
+    }
+#endif
+
+    uint8_t *chunk = (uint8_t*)malloc(PLIR256_TREE_LEAF_SIZE);
+    if (!chunk) {
+        return ENOMEM;
+    }
+    COUNT_ALLOC();
+
+    plir256_ctx root;
+    uint64_t total = 0;
+    plir256_tree_init(&root, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES);
+    for (uint64_t i = 0; ; i++) {
+        READ_BEGIN(t);
+        size_t n = fread(chunk, 1, PLIR256_TREE_LEAF_SIZE, fp);
+        READ_END(n, t);
+        if (n == 0 && i > 0) {
+            break;
+        }
+        plir256_tree_leaf(i, chunk, n, PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES, digest);
+        plir256_tree_add_leaf(&root, digest);
+        total += n;
+        if (n < PLIR256_TREE_LEAF_SIZE) {
+            break;
+        }
+    }
+    free(chunk);
+    if (ferror(fp)) {
+        return errno ? errno : EIO;
+    }
+
+    plir256_tree_final(&root, total, digest);
+    plir256_to_hex(digest, out_hash);
+    return 0;
+}
+
+/* Returns 0, or an errno value on failure. */
+int hash_file_contents(const char *filename, char *out_hash) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return errno;
+    }
+
+    int rc = -1;
+    if (tree_mode) {
+        rc = hash_tree_stream(fp, out_hash);
+    }
+#ifndef _WIN32
+    if (rc < 0) {
+        rc = hash_mapped(fp, out_hash);
+    }
+#endif
+    if (rc < 0) {
+        rc = hash_stream(fp, out_hash);
+    }
+    fclose(fp);
+    return rc;
+}
+
+#ifndef _WIN32
+/*
+ * --cache FILE: digests of previously hashed files, keyed by what stat()
+ * reports. The file is a 24-byte header followed by fixed-size entries sorted
+ * by key, in native byte order (it is only meaningful on the machine that
+ * wrote it), so it can be mapped and binary-searched without parsing.
+ * Each entry records when a run last used it; entries unused for
+ * CACHE_MAX_AGE are dropped, so files deleted or renamed since age out.
+ */
+#define CACHE_MAGIC   "PLIRCACH"
+#define CACHE_VERSION 1
+
+#define CACHE_MAX_AGE   (30 * 24 * 3600)
+#define CACHE_TOUCH_AGE (24 * 3600)
+
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint32_t rounds;
+    uint32_t stages;
+    uint32_t flags;
+    uint32_t last_used;
+    uint64_t size;
+    uint64_t mtime_ns;
+    uint8_t  digest[PLIR256_DIGEST_SIZE];
+} cache_entry;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t count;
+} cache_header;
+
+#define CACHE_FLAG_TREE 1U
+
+static const char *cache_path = NULL;
+static const cache_entry *cache_entries = NULL;
+static size_t cache_count = 0;
+static time_t cache_run_start;
+
+/* Orders by file identity and hash settings first, then by size and mtime. */
+static int compare_cache_entries(const void *a, const void *b) {
+    const cache_entry *x = (const cache_entry*)a, *y = (const cache_entry*)b;
+#define CACHE_CMP(field) if (x->field != y->field) return x->field < y->field ? -1 : 1;
+    CACHE_CMP(dev) CACHE_CMP(ino) CACHE_CMP(rounds) CACHE_CMP(stages) CACHE_CMP(flags)
+    CACHE_CMP(size) CACHE_CMP(mtime_ns)
+#undef CACHE_CMP
+    return 0;
+}
+
+static int same_cached_file(const cache_entry *x, const cache_entry *y) {
+    return x->dev == y->dev && x->ino == y->ino && x->rounds == y->rounds
+        && x->stages == y->stages && x->flags == y->flags;
+}
+
+void cache_load(const char *path) {
+    cache_path = path;
+    cache_run_start = time(NULL);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return;
+    }
+    const uint8_t *data;
+    size_t size;
+    if (map_file(fp, &data, &size) == 0) {
+        const cache_header *hdr = (const cache_header*)data;
+        if (size >= sizeof(*hdr) && memcmp(hdr->magic, CACHE_MAGIC, 8) == 0
+            && hdr->version == CACHE_VERSION && hdr->entry_size == sizeof(cache_entry)
+            && hdr->count == (size - sizeof(*hdr)) / sizeof(cache_entry)) {
+            cache_entries = (const cache_entry*)(data + sizeof(*hdr));
+            cache_count = (size_t)hdr->count;
+        } else {
+            fprintf(stderr, "plirsum: %s: not a valid cache file, rebuilding it\n", path);
+            munmap((void *)data, size);
+        }
+    }
+    fclose(fp);
+}
+
+/*
+ * Fills key from stat(). Returns -1 for files that must not be cached:
+ * non-regular files, and files modified so recently that a later write could
+ * land within the same mtime tick.
+ */
+static int cache_key(const char *filename, cache_entry *key) {
+    struct stat st;
+    if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode) || st.st_mtime >= cache_run_start - 1) {
+        return -1;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->dev = (uint64_t)st.st_dev;
+    key->ino = (uint64_t)st.st_ino;
+    key->rounds = PLIR256_DEFAULT_ROUNDS;
+    key->stages = PLIR256_DEFAULT_STAGES;
+    key->flags = tree_mode ? CACHE_FLAG_TREE : 0;
+    key->size = (uint64_t)st.st_size;
+    key->mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + (uint64_t)st.st_mtim.tv_nsec;
+    key->last_used = (uint32_t)cache_run_start;
+    return 0;
+}
+
+static int cache_expired(const cache_entry *entry, time_t max_age) {
+    return (int64_t)entry->last_used + max_age < (int64_t)cache_run_start;
+}
+
+static const cache_entry *cache_lookup(const cache_entry *key) {
+    if (!cache_entries) {
+        return NULL;
+    }
+    return (const cache_entry*)bsearch(key, cache_entries, cache_count, sizeof(cache_entry),
+                                       compare_cache_entries);
+}
+#endif
+
+typedef struct {
+    const char *filename;
+    const char *expected;
+    char hash[PLIR256_HEX_SIZE];
+    int err;
+    int done;
+    int partial;
+#ifndef _WIN32
+    int cache_keyed;
+    int cache_new;
+    cache_entry cached;
+#endif
+} file_job;
+
+#ifndef _WIN32
+static void hex_to_digest(const char *hex, uint8_t digest[PLIR256_DIGEST_SIZE]) {
+    for (int i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+        char pair[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+        digest[i] = (uint8_t)strtoul(pair, NULL, 16);
+    }
+}
+
+/*
+ * Rewrites the cache with this run's new and refreshed entries merged in,
+ * replacing any older entry for the same file and dropping entries no run
+ * has used for CACHE_MAX_AGE. Written to a temporary file and renamed so
+ * concurrent readers always see a complete cache.
+ */
+void cache_save(const file_job *jobs, size_t count) {
+    if (!cache_path) {
+        return;
+    }
+    size_t fresh = 0, expired = 0;
+    for (size_t i = 0; i < count; i++) {
+        fresh += jobs[i].cache_new;
+    }
+    for (size_t i = 0; i < cache_count; i++) {
+        expired += cache_expired(&cache_entries[i], CACHE_MAX_AGE);
+    }
+    if (fresh == 0 && expired == 0) {
+        return;
+    }
+
+    cache_entry *merged = (cache_entry*)malloc((fresh + cache_count) * sizeof(cache_entry));
+    if (!merged) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].cache_new) {
+            merged[n++] = jobs[i].cached;
+        }
+    }
+    qsort(merged, n, sizeof(cache_entry), compare_cache_entries);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (kept == 0 || !same_cached_file(&merged[kept - 1], &merged[i])) {
+            merged[kept++] = merged[i];
+        }
+    }
+    n = kept;
+    for (size_t i = 0; i < cache_count; i++) {
+        const cache_entry *old = &cache_entries[i];
+        size_t lo = 0, hi = kept;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (compare_cache_entries(&merged[mid], old) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        int superseded = (lo < kept && same_cached_file(&merged[lo], old))
+                      || (lo > 0 && same_cached_file(&merged[lo - 1], old));
+        if (!superseded && !cache_expired(old, CACHE_MAX_AGE)) {
+            merged[n++] = *old;
+        }
+    }
+    qsort(merged, n, sizeof(cache_entry), compare_cache_entries);
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", cache_path, (long)getpid());
+    FILE *fp = fopen(tmp_path, "wb");
+    cache_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_MAGIC, 8);
+    hdr.version = CACHE_VERSION;
+    hdr.entry_size = sizeof(cache_entry);
+    hdr.count = n;
+
+    int ok = fp && fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+          && fwrite(merged, sizeof(cache_entry), n, fp) == n;
+    if (fp && fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_path, cache_path) != 0) {
+        fprintf(stderr, "plirsum: %s: could not write cache: %s\n", cache_path, strerror(errno));
+        remove(tmp_path);
+    }
+    free(merged);
+}
+#endif
+
+typedef struct {
+    file_job *jobs;
+    size_t count;
+    size_t next;
+#ifndef _WIN32
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+#endif
+} job_queue;
+
+typedef struct {
+    size_t unreadable;
+    size_t mismatched;
+} job_totals;
+
+/*
+ * Fills job->hash from the cache and returns 1 on a hit. A hit not used for
+ * a day is saved again with the new use time, so it does not age out.
+ */
+static int cache_probe(file_job *job) {
+#ifndef _WIN32
+    if (cache_path && cache_key(job->filename, &job->cached) == 0) {
+        job->cache_keyed = 1;
+        const cache_entry *hit = cache_lookup(&job->cached);
+        if (hit) {
+            plir256_to_hex(hit->digest, job->hash);
+            job->err = 0;
+            if (cache_expired(hit, CACHE_TOUCH_AGE)) {
+                memcpy(job->cached.digest, hit->digest, PLIR256_DIGEST_SIZE);
+                job->cache_new = 1;
+            }
+            return 1;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void cache_record(file_job *job) {
+#ifndef _WIN32
+    if (job->cache_keyed && !job->err) {
+        hex_to_digest(job->hash, job->cached.digest);
+        job->cache_new = 1;
+    }
+#endif
+}
+
+static int hash_file_head_tail(const char *filename, char *out_hash);
+
+static void run_job(file_job *job) {
+    if (job->partial) {
+        job->err = hash_file_head_tail(job->filename, job->hash);
+        return;
+    }
+    if (cache_probe(job)) {
+        return;
+    }
+    job->err = hash_file_contents(job->filename, job->hash);
+    cache_record(job);
+}
+
+/*
+ * Workers claim the next unhashed file from a shared counter, so a worker
+ * stuck on one huge file never holds up the files behind it.
+ */
+#ifndef _WIN32
+static void job_done(job_queue *q, file_job *job) {
+    pthread_mutex_lock(&q->lock);
+    job->done = 1;
+    pthread_cond_broadcast(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void *hash_worker(void *arg) {
+    job_queue *q = (job_queue*)arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+        if (i >= q->count) {
+            return NULL;
+        }
+        run_job(&q->jobs[i]);
+        job_done(q, &q->jobs[i]);
+    }
+}
+#endif
+
+/* Prints "HASH  FILENAME", or "FILENAME: OK|FAILED" for jobs with an expected hash. */
+static void report_job(const file_job *job, job_totals *totals) {
+    if (job->err) {
+        fflush(stdout);
+        fprintf(stderr, "plirsum: %s: %s\n", job->filename, strerror(job->err));
+        if (job->expected) {
+            printf("%s: FAILED open or read\n", job->filename);
+        }
+        totals->unreadable++;
+        return;
+    }
+
+    if (job->expected) {
+        int ok = constant_time_compare(job->hash, job->expected);
+        printf("%s: %s\n", job->filename, ok ? "OK" : "FAILED");
+        totals->mismatched += !ok;
+        return;
+    }
+    printf("%s  %s\n", job->hash, job->filename);
+}
+
+#ifndef _WIN32
+/*
+ * Starts `workers` threads running worker(arg), which must complete every job
+ * of q through job_done(), and reports the jobs in order as they finish.
+ * Returns -1 without touching any job if no thread could be started.
+ */
+static int run_pool(job_queue *q, size_t workers, void *(*worker)(void *), void *arg,
+                    job_totals *totals) {
+    pthread_t *tids = (pthread_t*)malloc(workers * sizeof(pthread_t));
+    if (!tids) {
+        return -1;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->ready, NULL);
+
+    size_t started = 0;
+    while (started < workers && pthread_create(&tids[started], NULL, worker, arg) == 0) {
+        started++;
+    }
+    if (started > 0) {
+        for (size_t i = 0; i < q->count; i++) {
+            pthread_mutex_lock(&q->lock);
+            while (!q->jobs[i].done) {
+                pthread_cond_wait(&q->ready, &q->lock);
+            }
+            pthread_mutex_unlock(&q->lock);
+            if (totals) {
+                report_job(&q->jobs[i], totals);
+            }
+        }
+        for (size_t t = 0; t < started; t++) {
+            pthread_join(tids[t], NULL);
+        }
+    }
+    pthread_cond_destroy(&q->ready);
+    pthread_mutex_destroy(&q->lock);
+    free(tids);
+    return started > 0 ? 0 : -1;
+}
+#endif
+
+/*
+ * Hashes every job on up to `threads` workers and reports the results in
+ * order as they become available. With no totals nothing is reported.
+ */
+static void run_jobs(file_job *jobs, size_t count, int threads, job_totals *totals) {
+    job_queue q;
+    q.jobs = jobs;
+    q.count = count;
+    q.next = 0;
+
+    size_t workers = threads > 1 ? (size_t)threads : 1;
+    if (workers > count) {
+        workers = count;
+    }
+
+#ifndef _WIN32
+    if (workers > 1 && run_pool(&q, workers, hash_worker, &q, totals) == 0) {
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++) {
+        run_job(&jobs[i]);
+        if (totals) {
+            report_job(&jobs[i], totals);
+        }
+    }
+}
+
+/*
+ * -r: async read pipeline. Each of the -j worker threads keeps its share of
+ * URING_DEPTH files in flight on its own io_uring, one open or read
+ * outstanding per file, and feeds each completed buffer to that file's
+ * streaming context, so many small files cost disk time rather than a round
+ * of blocking syscalls each. Where io_uring or the opcodes used here are
+ * missing, the caller falls back to the worker pool in run_jobs().
+ */
+#ifdef HAVE_IO_URING
+#define URING_DEPTH     64
+#define URING_MIN_DEPTH 8
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned queued;
+} uring;
+
+static int uring_setup(uring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) {
+        return -1;
+    }
+    r->entries = p.sq_entries;
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_size > r->sq_ring_size) {
+            r->sq_ring_size = r->cq_ring_size;
+        }
+        r->cq_ring_size = r->sq_ring_size;
+    }
+
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            munmap(r->sq_ring, r->sq_ring_size);
+            close(r->fd);
+            return -1;
+        }
+    }
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (r->cq_ring != r->sq_ring) {
+            munmap(r->cq_ring, r->cq_ring_size);
+        }
+        munmap(r->sq_ring, r->sq_ring_size);
+        close(r->fd);
+        return -1;
+    }
+
+    uint8_t *sq = (uint8_t*)r->sq_ring, *cq = (uint8_t*)r->cq_ring;
+    r->sq_head = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static void uring_close(uring *r) {
+    munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring != r->sq_ring) {
+        munmap(r->cq_ring, r->cq_ring_size);
+    }
+    munmap(r->sq_ring, r->sq_ring_size);
+    close(r->fd);
+}
+
+/* IORING_OP_OPENAT and IORING_OP_READ need Linux 5.6; older rings accept them but fail each one. */
+static int uring_supported(void) {
+    uring r;
+    if (uring_setup(&r, 1) != 0) {
+        return 0;
+    }
+    struct io_uring_probe *probe = (struct io_uring_probe*)calloc(1,
+        sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+    int ok = probe && syscall(__NR_io_uring_register, r.fd, IORING_REGISTER_PROBE, probe, 256) == 0
+          && probe->last_op >= IORING_OP_READ && probe->last_op >= IORING_OP_OPENAT
+          && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+          && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    uring_close(&r);
+    return ok;
+}
+
+/* Only this thread writes the SQ tail, so no free-slot check beyond the head is needed. */
+static struct io_uring_sqe *uring_get_sqe(uring *r) {
+    unsigned tail = *r->sq_tail;
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= r->entries) {
+        return NULL;
+    }
+    unsigned index = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[index] = index;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->queued++;
+    return sqe;
+}
+
+/* Submits queued entries and waits for at least one completion. */
+static int uring_submit_and_wait(uring *r) {
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, r->fd, r->queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret >= 0) {
+            r->queued -= (unsigned)ret;
+            return 0;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+static struct io_uring_cqe *uring_peek_cqe(uring *r) {
+    unsigned head = *r->cq_head;
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &r->cqes[head & *r->cq_mask];
+}
+
+static void uring_cqe_seen(uring *r) {
+    __atomic_store_n(r->cq_head, *r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    file_job *job;
+    int fd;
+    uint64_t offset;
+    plir256_ctx ctx;
+    uint8_t *buffer;
+} read_slot;
+
+static void queue_open(uring *r, read_slot *slot, size_t index) {
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)slot->job->filename;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = index;
+}
+
+static void queue_read(uring *r, read_slot *slot, size_t index) {
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot->fd;
+    sqe->addr = (uint64_t)(uintptr_t)slot->buffer;
+    sqe->len = READ_CHUNK_SIZE;
+    sqe->off = slot->offset;
+    sqe->user_data = index;
+}
+
+static void finish_slot(job_queue *q, read_slot *slot, int err) {
+    file_job *job = slot->job;
+    if (slot->fd >= 0) {
+        close(slot->fd);
+    }
+    job->err = err;
+    if (!err) {
+        uint8_t digest[PLIR256_DIGEST_SIZE];
+        plir256_final(&slot->ctx, digest);
+        plir256_to_hex(digest, job->hash);
+        cache_record(job);
+    }
+    slot->job = NULL;
+    job_done(q, job);
+}
+
+/*
+ * Waits for the in_flight submitted operations of a ring that can no longer
+ * submit, closing any file their opens returned. Returns 0 if the ring fails
+ * first: the kernel may then still write into the read buffers after the
+ * ring is closed, so the caller must not free them.
+ */
+static int uring_drain(uring *r, read_slot *slots, size_t in_flight) {
+    while (in_flight > 0) {
+        if (syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(r)) != NULL) {
+            read_slot *slot = &slots[cqe->user_data];
+            if (slot->fd < 0 && cqe->res >= 0) {
+                slot->fd = cqe->res;
+            }
+            uring_cqe_seen(r);
+            in_flight--;
+        }
+    }
+    return 1;
+}
+
+/* Hands a slot's file back to a blocking read from the start. */
+static void requeue_slot(job_queue *q, read_slot *slot) {
+    file_job *job = slot->job;
+    if (slot->fd >= 0) {
+        close(slot->fd);
+    }
+    slot->job = NULL;
+    run_job(job);
+    job_done(q, job);
+}
+
+typedef struct {
+    job_queue q;
+    size_t depth;
+} uring_queue;
+
+/*
+ * Claims jobs from the shared counter while it has a free slot. A thread
+ * whose ring cannot be set up, or fails, hashes its files in flight and the
+ * rest with blocking reads.
+ */
+static void *uring_worker(void *arg) {
+    uring_queue *uq = (uring_queue*)arg;
+    job_queue *q = &uq->q;
+    size_t depth = uq->depth;
+    uring r;
+    if (uring_setup(&r, (unsigned)depth) != 0) {
+        return hash_worker(q);
+    }
+
+    read_slot slots[URING_DEPTH];
+    uint8_t *buffers = (uint8_t*)malloc(depth * READ_CHUNK_SIZE);
+    if (!buffers) {
+        uring_close(&r);
+        return hash_worker(q);
+    }
+    COUNT_ALLOC();
+    for (size_t s = 0; s < depth; s++) {
+        slots[s].job = NULL;
+        slots[s].buffer = buffers + s * READ_CHUNK_SIZE;
+    }
+
+    size_t active = 0;
+    int claimed_all = 0;
+    for (;;) {
+        for (size_t s = 0; s < depth && !claimed_all; s++) {
+            if (slots[s].job) {
+                continue;
+            }
+            size_t i = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+            if (i >= q->count) {
+                claimed_all = 1;
+                break;
+            }
+            file_job *job = &q->jobs[i];
+            if (cache_probe(job)) {
+                job_done(q, job);
+                continue;
+            }
+            slots[s].job = job;
+            slots[s].fd = -1;
+            slots[s].offset = 0;
+            queue_open(&r, &slots[s], s);
+            active++;
+        }
+        if (active == 0) {
+            if (claimed_all) {
+                break;
+            }
+            continue;
+        }
+
+        READ_BEGIN(wait);
+        int submitted = uring_submit_and_wait(&r);
+        READ_WAIT_END(wait);
+        if (submitted != 0) {
+            if (uring_drain(&r, slots, active - r.queued)) {
+                uring_close(&r);
+                free(buffers);
+            } else {
+                uring_close(&r);
+            }
+            for (size_t s = 0; s < depth; s++) {
+                if (slots[s].job) {
+                    requeue_slot(q, &slots[s]);
+                }
+            }
+            return hash_worker(q);
+        }
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(&r)) != NULL) {
+            size_t s = (size_t)cqe->user_data;
+            int res = cqe->res;
+            uring_cqe_seen(&r);
+
+            read_slot *slot = &slots[s];
+            if (res == -EINTR || res == -EAGAIN) {
+                if (slot->fd < 0) {
+                    queue_open(&r, slot, s);
+                } else {
+                    queue_read(&r, slot, s);
+                }
+            } else if (res < 0) {
+                finish_slot(q, slot, -res);
+                active--;
+            } else if (slot->fd < 0) {
+                slot->fd = res;
+                plir256_init(&slot->ctx);
+                queue_read(&r, slot, s);
+            } else if (res == 0) {
+                finish_slot(q, slot, 0);
+                active--;
+            } else {
+                COUNT_READ((uint64_t)res);
+                plir256_update(&slot->ctx, slot->buffer, (size_t)res);
+                slot->offset += (uint64_t)res;
+                queue_read(&r, slot, s);
+            }
+        }
+    }
+
+    free(buffers);
+    uring_close(&r);
+    return NULL;
+}
+
+/*
+ * Splits URING_DEPTH in-flight files over up to `threads` rings. Returns -1
+ * without touching any job if io_uring cannot be used.
+ */
+static int run_jobs_async(file_job *jobs, size_t count, int threads, job_totals *totals) {
+    if (!uring_supported()) {
+        return -1;
+    }
+
+    size_t workers = threads > 1 ? (size_t)threads : 1;
+    if (workers > URING_DEPTH / URING_MIN_DEPTH) {
+        workers = URING_DEPTH / URING_MIN_DEPTH;
+    }
+    if (workers > count) {
+        workers = count ? count : 1;
+    }
+
+    uring_queue uq;
+    uq.q.jobs = jobs;
+    uq.q.count = count;
+    uq.q.next = 0;
+    uq.depth = URING_DEPTH / workers;
+    return run_pool(&uq.q, workers, uring_worker, &uq, totals);
+}
+#endif
+
+#ifndef _WIN32
+typedef struct {
+    char **names;
+    size_t count;
+    size_t capacity;
+} file_list;
+
+static int file_list_add(file_list *list, char *name) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        char **names = (char**)realloc(list->names, capacity * sizeof(char*));
+        if (!names) {
+            return -1;
+        }
+        list->names = names;
+        list->capacity = capacity;
+    }
+    list->names[list->count++] = name;
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+ * Appends path, or the regular files under it in sorted order if it is a
+ * directory. Below the operand itself, symbolic links to directories are not
+ * followed and special files are skipped. Returns the number of entries that
+ * could not be read.
+ */
+static size_t walk_path(const char *path, int operand, file_list *list) {
+    struct stat st;
+    if ((operand ? stat(path, &st) : lstat(path, &st)) != 0) {
+        fprintf(stderr, "plirsum: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        if (operand || S_ISREG(st.st_mode)
+            || (S_ISLNK(st.st_mode) && stat(path, &st) == 0 && S_ISREG(st.st_mode))) {
+            char *name = strdup(path);
+            if (!name || file_list_add(list, name) != 0) {
+                fprintf(stderr, "Memory allocation failed.\n");
+                free(name);
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "plirsum: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    file_list entries = { NULL, 0, 0 };
+    size_t failed = 0;
+    size_t path_len = strlen(path);
+    int slash = path_len > 0 && path[path_len - 1] == '/';
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        size_t size = path_len + strlen(de->d_name) + 2;
+        char *child = (char*)malloc(size);
+        if (!child || file_list_add(&entries, child) != 0) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            free(child);
+            failed++;
+            break;
+        }
+        snprintf(child, size, slash ? "%s%s" : "%s/%s", path, de->d_name);
+    }
+    closedir(dir);
+
+    qsort(entries.names, entries.count, sizeof(char*), compare_names);
+    for (size_t i = 0; i < entries.count; i++) {
+        failed += walk_path(entries.names[i], 0, list);
+        free(entries.names[i]);
+    }
+    free(entries.names);
+    return failed;
+}
+#endif
+
+/* Returns 1 if any file could not be hashed. */
+int hash_files(char **filenames, size_t count, int threads) {
+    file_job *jobs = (file_job*)calloc(count, sizeof(file_job));
+    if (!jobs) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].filename = filenames[i];
+    }
+
+    job_totals totals = { 0, 0 };
+    int done = 0;
+#ifdef HAVE_IO_URING
+    done = recursive && !tree_mode && run_jobs_async(jobs, count, threads, &totals) == 0;
+#endif
+    if (!done) {
+        run_jobs(jobs, count, threads, &totals);
+    }
+#ifndef _WIN32
+    cache_save(jobs, count);
+#endif
+    free(jobs);
+    return totals.unreadable ? 1 : 0;
+}
+
+/* --dups: bytes read from each end of a file for the partial digest. */
+#define DUP_PARTIAL_SIZE (4 * 1024)
+
+/*
+ * Partial digest for --dups: PLIR-256 of the first and last DUP_PARTIAL_SIZE
+ * bytes. Files up to twice that size are read whole, so for them it is the
+ * plain digest of the file.
+ */
+static int hash_file_head_tail(const char *filename, char *out_hash) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return errno;
+    }
+
+    uint8_t buffer[2 * DUP_PARTIAL_SIZE + 1];
+    READ_BEGIN(t);
+    size_t got = fread(buffer, 1, sizeof(buffer), fp);
+    READ_END(got, t);
+    int err = ferror(fp) ? (errno ? errno : EIO) : 0;
+    if (!err && got > 2 * DUP_PARTIAL_SIZE) {
+#ifdef _WIN32
+        int sought = _fseeki64(fp, -(long long)DUP_PARTIAL_SIZE, SEEK_END);
+#else
+        int sought = fseeko(fp, -(off_t)DUP_PARTIAL_SIZE, SEEK_END);
+#endif
+        if (sought != 0 || fread(buffer + DUP_PARTIAL_SIZE, 1, DUP_PARTIAL_SIZE, fp) != DUP_PARTIAL_SIZE) {
+            err = errno ? errno : EIO;
+        }
+        got = 2 * DUP_PARTIAL_SIZE;
+    }
+    fclose(fp);
+    if (err) {
+        return err;
+    }
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256(buffer, got, digest);
+    plir256_to_hex(digest, out_hash);
+    return 0;
+}
+
+#ifndef _WIN32
+typedef struct {
+    const char *name;
+    uint64_t size;
+    uint64_t dev;
+    uint64_t ino;
+    char key[PLIR256_HEX_SIZE];
+    size_t variant;
+    int err;
+} dup_entry;
+
+/* Largest files first, then by key, variant and name, so groups are adjacent. */
+static int compare_dups(const void *a, const void *b) {
+    const dup_entry *x = (const dup_entry*)a, *y = (const dup_entry*)b;
+    if (x->size != y->size) {
+        return x->size > y->size ? -1 : 1;
+    }
+    int c = strcmp(x->key, y->key);
+    if (c) {
+        return c;
+    }
+    if (x->variant != y->variant) {
+        return x->variant < y->variant ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+static int same_dup_group(const dup_entry *x, const dup_entry *y) {
+    return x->size == y->size && strcmp(x->key, y->key) == 0 && x->variant == y->variant;
+}
+
+/* Sorts entries and drops those whose (size, key) group has a single member. */
+static size_t keep_groups(dup_entry *entries, size_t n) {
+    qsort(entries, n, sizeof(dup_entry), compare_dups);
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i + 1;
+        while (j < n && same_dup_group(&entries[i], &entries[j])) {
+            j++;
+        }
+        if (j - i > 1) {
+            for (size_t k = i; k < j; k++) {
+                entries[kept++] = entries[k];
+            }
+        }
+        i = j;
+    }
+    return kept;
+}
+
+/*
+ * Sets each entry's key to its head/tail digest on the worker pool.
+ * Unreadable files are reported and dropped. Returns the new count.
+ */
+static size_t key_entries(dup_entry *entries, size_t n, int threads, size_t *unreadable) {
+    file_job *jobs = (file_job*)calloc(n ? n : 1, sizeof(file_job));
+    if (!jobs) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        *unreadable += n;
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        jobs[i].filename = entries[i].name;
+        jobs[i].partial = 1;
+    }
+    run_jobs(jobs, n, threads, NULL);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (jobs[i].err) {
+            fprintf(stderr, "plirsum: %s: %s\n", jobs[i].filename, strerror(jobs[i].err));
+            (*unreadable)++;
+            continue;
+        }
+        entries[kept] = entries[i];
+        memcpy(entries[kept].key, jobs[i].hash, PLIR256_HEX_SIZE);
+        kept++;
+    }
+    free(jobs);
+    return kept;
+}
+
+static int compare_inodes(const void *a, const void *b) {
+    const dup_entry *x = (const dup_entry*)a, *y = (const dup_entry*)b;
+    if (x->dev != y->dev) {
+        return x->dev < y->dev ? -1 : 1;
+    }
+    if (x->ino != y->ino) {
+        return x->ino < y->ino ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+/*
+ * Keeps one name per (device, inode): hard links and repeated operands are
+ * the same data, so neither is a duplicate that could be removed.
+ */
+static size_t drop_links(dup_entry *entries, size_t n) {
+    qsort(entries, n, sizeof(dup_entry), compare_inodes);
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (kept == 0 || entries[kept - 1].dev != entries[i].dev || entries[kept - 1].ino != entries[i].ino) {
+            entries[kept++] = entries[i];
+        }
+    }
+    return kept;
+}
+
+/*
+ * Compares two files of the same size byte by byte. A read error is stored
+ * in the entry it belongs to; such pairs compare unequal. With a ctx, a's
+ * bytes are hashed along the way and an equal pair gets a's full digest as
+ * a's key.
+ */
+static int same_bytes(dup_entry *a, dup_entry *b, uint8_t *buf_a, uint8_t *buf_b, plir256_ctx *ctx) {
+    FILE *fa = fopen(a->name, "rb");
+    FILE *fb = fopen(b->name, "rb");
+    int same = fa && fb;
+    if (!fa) {
+        a->err = errno;
+    }
+    if (!fb) {
+        b->err = errno;
+    }
+
+    uint64_t left = a->size;
+    while (same && left > 0) {
+        size_t want = left < READ_CHUNK_SIZE ? (size_t)left : READ_CHUNK_SIZE;
+        READ_BEGIN(t);
+        size_t got_a = fread(buf_a, 1, want, fa);
+        size_t got_b = fread(buf_b, 1, want, fb);
+        READ_END(got_a + got_b, t);
+        if (ferror(fa)) {
+            a->err = errno ? errno : EIO;
+        }
+        if (ferror(fb)) {
+            b->err = errno ? errno : EIO;
+        }
+        same = !a->err && !b->err && got_a == want && got_b == want
+            && memcmp(buf_a, buf_b, want) == 0;
+        if (same && ctx) {
+            plir256_update(ctx, buf_a, want);
+        }
+        left -= want;
+    }
+    if (same && ctx) {
+        uint8_t digest[PLIR256_DIGEST_SIZE];
+        plir256_final(ctx, digest);
+        plir256_to_hex(digest, a->key);
+    }
+    if (fa) {
+        fclose(fa);
+    }
+    if (fb) {
+        fclose(fb);
+    }
+    return same;
+}
+
+typedef struct {
+    dup_entry *entries;
+    size_t *starts;         /* group g is entries[starts[g]] .. entries[starts[g + 1] - 1] */
+    size_t groups;
+    size_t next;
+} dup_split;
+
+/*
+ * Splits each group into byte-identical subsets, comparing every file with
+ * the first file of each subset found so far; variant is the index of that
+ * first file, so subsets of different groups never merge. The first compare
+ * that matches also yields the subset's full digest, which replaces the
+ * head/tail key of all its files, so no file is read in full twice.
+ */
+static void *split_worker(void *arg) {
+    dup_split *d = (dup_split*)arg;
+    uint8_t *buf_a = (uint8_t*)malloc(READ_CHUNK_SIZE);
+    uint8_t *buf_b = (uint8_t*)malloc(READ_CHUNK_SIZE);
+    size_t *firsts = NULL;
+    int *hashed = NULL;
+    size_t firsts_cap = 0;
+    COUNT_ALLOC();
+    COUNT_ALLOC();
+
+    for (;;) {
+        size_t g = __atomic_fetch_add(&d->next, 1, __ATOMIC_RELAXED);
+        if (g >= d->groups) {
+            break;
+        }
+        dup_entry *group = d->entries + d->starts[g];
+        size_t k = d->starts[g + 1] - d->starts[g];
+        if (group->size == 0) {
+            continue;
+        }
+        if (k > firsts_cap) {
+            free(firsts);
+            free(hashed);
+            firsts_cap = k;
+            firsts = (size_t*)malloc(firsts_cap * sizeof(size_t));
+            hashed = (int*)malloc(firsts_cap * sizeof(int));
+        }
+        if (!buf_a || !buf_b || !firsts || !hashed) {
+            for (size_t i = 0; i < k; i++) {
+                group[i].err = ENOMEM;
+            }
+            continue;
+        }
+
+        size_t variants = 0;
+        for (size_t i = 0; i < k; i++) {
+            size_t v = 0;
+            while (v < variants && !group[i].err) {
+                plir256_ctx ctx;
+                dup_entry *first = &group[firsts[v]];
+                plir256_init(&ctx);
+                if (!first->err && same_bytes(first, &group[i], buf_a, buf_b, hashed[v] ? NULL : &ctx)) {
+                    hashed[v] = 1;
+                    break;
+                }
+                v++;
+            }
+            if (v == variants) {
+                hashed[variants] = 0;
+                firsts[variants++] = i;
+            }
+            group[i].variant = d->starts[g] + firsts[v];
+        }
+        for (size_t i = 0; i < k; i++) {
+            memcpy(group[i].key, d->entries[group[i].variant].key, PLIR256_HEX_SIZE);
+        }
+    }
+    free(firsts);
+    free(hashed);
+    free(buf_a);
+    free(buf_b);
+    return NULL;
+}
+
+/*
+ * Splits every (size, head/tail digest) group into byte-identical subsets on
+ * up to `threads` threads, one group at a time. Files that could not be read are
+ * reported and dropped. Returns the new count, with singletons dropped.
+ */
+static size_t split_groups(dup_entry *entries, size_t n, int threads, size_t *unreadable) {
+    dup_split d;
+    d.entries = entries;
+    d.groups = 0;
+    d.next = 0;
+    d.starts = (size_t*)malloc((n + 1) * sizeof(size_t));
+    if (!d.starts) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        *unreadable += n;
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || !same_dup_group(&entries[i - 1], &entries[i])) {
+            d.starts[d.groups++] = i;
+        }
+    }
+    d.starts[d.groups] = n;
+
+    size_t workers = threads > 1 ? (size_t)threads : 1;
+    if (workers > d.groups) {
+        workers = d.groups;
+    }
+    pthread_t *tids = workers > 1 ? (pthread_t*)malloc(workers * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    while (tids && started < workers && pthread_create(&tids[started], NULL, split_worker, &d) == 0) {
+        started++;
+    }
+    split_worker(&d);
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    free(tids);
+    free(d.starts);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (entries[i].err) {
+            fprintf(stderr, "plirsum: %s: %s\n", entries[i].name, strerror(entries[i].err));
+            (*unreadable)++;
+            continue;
+        }
+        entries[kept++] = entries[i];
+    }
+    return keep_groups(entries, kept);
+}
+
+/*
+ * --dups DIR...: prints groups of identical files, largest first, as
+ * "HASH  FILE" lines with a blank line between groups. Files with a unique
+ * size are never opened; the rest are narrowed by a head/tail digest, and
+ * the files left are compared byte by byte.
+ */
+int find_dups(char **operands, size_t count, int threads) {
+    file_list list = { NULL, 0, 0 };
+    size_t unreadable = 0;
+    for (size_t i = 0; i < count; i++) {
+        unreadable += walk_path(operands[i], 1, &list);
+    }
+
+    dup_entry *entries = (dup_entry*)calloc(list.count ? list.count : 1, sizeof(dup_entry));
+    if (!entries) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        struct stat st;
+        if (stat(list.names[i], &st) != 0) {
+            fprintf(stderr, "plirsum: %s: %s\n", list.names[i], strerror(errno));
+            unreadable++;
+            continue;
+        }
+        entries[n].name = list.names[i];
+        entries[n].size = (uint64_t)st.st_size;
+        entries[n].dev = (uint64_t)st.st_dev;
+        entries[n].ino = (uint64_t)st.st_ino;
+        n++;
+    }
+    n = keep_groups(entries, drop_links(entries, n));
+
+    dup_entry *found = (dup_entry*)malloc((n ? n : 1) * sizeof(dup_entry));
+    if (!found) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+    size_t n_found = 0;
+
+    /* Sorted largest first, so empty files (all identical) are at the end. */
+    uint8_t empty_digest[PLIR256_DIGEST_SIZE];
+    plir256(NULL, 0, empty_digest);
+    while (n > 0 && entries[n - 1].size == 0) {
+        found[n_found] = entries[--n];
+        plir256_to_hex(empty_digest, found[n_found++].key);
+    }
+
+    n = keep_groups(entries, key_entries(entries, n, threads, &unreadable));
+    memcpy(found + n_found, entries, n * sizeof(dup_entry));
+    n_found += n;
+
+    free(entries);
+    entries = found;
+    n = split_groups(entries, keep_groups(entries, n_found), threads, &unreadable);
+
+    uint64_t reclaimable = 0;
+    size_t groups = 0;
+    for (size_t i = 0; i < n; i++) {
+        int first = i == 0 || !same_dup_group(&entries[i - 1], &entries[i]);
+        if (first) {
+            groups++;
+            if (i > 0) {
+                putchar('\n');
+            }
+        } else {
+            reclaimable += entries[i].size;
+        }
+        printf("%s  %s\n", entries[i].key, entries[i].name);
+    }
+    fflush(stdout);
+    fprintf(stderr, "plirsum: %zu duplicate groups, %zu files, %llu bytes reclaimable\n",
+            groups, n, (unsigned long long)reclaimable);
+
+    free(entries);
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.names[i]);
+    }
+    free(list.names);
+    return unreadable ? 1 : 0;
+}
+#endif
+
+/* Reads all of fp into a NUL-terminated heap buffer. */
+static char *read_all(FILE *fp, size_t *out_len) {
+    size_t cap = 64 * 1024, len = 0;
+    char *buf = (char*)malloc(cap);
+    while (buf) {
+        len += fread(buf + len, 1, cap - len - 1, fp);
+        if (len < cap - 1) {
+            break;
+        }
+        char *grown = (char*)realloc(buf, cap * 2);
+        if (!grown) {
+            free(buf);
+            return NULL;
+        }
+        buf = grown;
+        cap *= 2;
+    }
+    if (buf) {
+        buf[len] = '\0';
+        *out_len = len;
+    }
+    return buf;
+}
+
+/* "HASH  FILENAME": 64 hex digits, two spaces, a non-empty name. */
+static int parse_manifest_line(char *line, size_t len, file_job *job) {
+    if (len < 67 || line[64] != ' ' || line[65] != ' ') {
+        return -1;
+    }
+    for (int i = 0; i < 64; i++) {
+        char c = line[i];
+        if (c >= 'A' && c <= 'F') {
+            line[i] = (char)(c - 'A' + 'a');
+        } else if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return -1;
+        }
+    }
+    line[64] = '\0';
+    job->expected = line;
+    job->filename = line + 66;
+    return 0;
+}
+
+/*
+ * Verifies every entry of a manifest written by plirsum, in parallel.
+ * Returns 1 if any entry is malformed, unreadable or does not match.
+ */
+int check_manifest(const char *manifest, int threads) {
+    FILE *fp = strcmp(manifest, "-") == 0 ? stdin : fopen(manifest, "rb");
+    if (!fp) {
+        fprintf(stderr, "plirsum: %s: %s\n", manifest, strerror(errno));
+        return 1;
+    }
+    size_t size = 0;
+    char *text = read_all(fp, &size);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (!text) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
+
+    size_t lines = 1;
+    for (size_t i = 0; i < size; i++) {
+        lines += text[i] == '\n';
+    }
+    file_job *jobs = (file_job*)calloc(lines, sizeof(file_job));
+    if (!jobs) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        free(text);
+        return 1;
+    }
 
-static inline uint32_t rotate_left(uint32_t x, int n) {
-    return (x << n) | (x >> (32 - n));
-}
+    size_t count = 0, malformed = 0, line_no = 0;
+    char *line = text;
+    while (line < text + size) {
+        char *end = memchr(line, '\n', (size_t)(text + size - line));
+        char *next = end ? end + 1 : text + size;
+        size_t len = end ? (size_t)(end - line) : (size_t)(text + size - line);
+        line_no++;
+        if (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        line[len] = '\0';
+
+        if (len > 0) {
+            if (parse_manifest_line(line, len, &jobs[count]) == 0) {
+                count++;
+            } else {
+                fprintf(stderr, "plirsum: %s: %zu: improperly formatted checksum line\n", manifest, line_no);
+                malformed++;
+            }
+        }
+        line = next;
+    }
+
+    job_totals totals = { 0, 0 };
+    run_jobs(jobs, count, threads, &totals);
+#ifndef _WIN32
+    cache_save(jobs, count);
+#endif
+
+    fflush(stdout);
+    fprintf(stderr, "plirsum: %zu checked, %zu OK, %zu FAILED, %zu unreadable, %zu improperly formatted\n",
+            count, count - totals.mismatched - totals.unreadable, totals.mismatched,
+            totals.unreadable, malformed);
 
-uint32_t modular_mix(uint32_t x, uint32_t y) {
-    uint32_t result = (x * 33U) ^ (y * 19U)
-                    + rotate_left(x, 11)
-                    + rotate_left(y, 15)
-                    + (x >> 3)
-                    ^ (y << 2);
-    return result & 0xFFFFFFFF;
+    free(jobs);
+    free(text);
+    return (count == 0 || malformed || totals.mismatched || totals.unreadable) ? 1 : 0;
 }
 
-static int sum_ascii(const char *text) {
-    int total = 0;
-    while (*text) {
-        total += (unsigned char)(*text);
-        text++;
+/*
+ * Drops one trailing '\n', then one '\r', then one ' ', as the stdin path
+ * always has, so `echo text | plirsum` hashes "text".
+ */
+static size_t trim_record(const uint8_t *data, size_t len) {
+    if (len > 0 && data[len - 1] == '\n') {
+        len--;
+    }
+    if (len > 0 && data[len - 1] == '\r') {
+        len--;
+    }
+    if (len > 0 && data[len - 1] == ' ') {
+        len--;
     }
-    return total;
+    return len;
 }
 
-uint64_t get_nanotime() {
-    #ifdef _WIN32
-        LARGE_INTEGER freq, counter;
-        QueryPerformanceFrequency(&freq);
-        QueryPerformanceCounter(&counter);
-        uint64_t nanosec = (counter.QuadPart * 1000000000ULL) / freq.QuadPart;
-        return nanosec ^ ((uint64_t)GetTickCount() * 157U);
-    #else
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
-    #endif
+/*
+ * Hashes all of fp with the trimming above. The last three bytes are held
+ * back until EOF because they are the only ones the trim can remove.
+ */
+int hash_stdin(FILE *fp, char *out_hash) {
+    const size_t held_max = 3;
+    uint8_t *buffer = (uint8_t*)malloc(READ_CHUNK_SIZE + held_max);
+    if (!buffer) {
+        return ENOMEM;
+    }
+    COUNT_ALLOC();
+
+    plir256_ctx ctx;
+    plir256_init(&ctx);
+
+    size_t held = 0;
+    for (;;) {
+        READ_BEGIN(t);
+        size_t read_bytes = fread(buffer + held, 1, READ_CHUNK_SIZE, fp);
+        READ_END(read_bytes, t);
+        if (read_bytes == 0) {
+            break;
+        }
+        size_t total = held + read_bytes;
+        if (total > held_max) {
+            plir256_update(&ctx, buffer, total - held_max);
+            memmove(buffer, buffer + total - held_max, held_max);
+            held = held_max;
+        } else {
+            held = total;
+        }
+    }
+    if (ferror(fp)) {
+        free(buffer);
+        return errno ? errno : EIO;
+    }
+    plir256_update(&ctx, buffer, trim_record(buffer, held));
+    free(buffer);
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    plir256_final(&ctx, digest);
+    plir256_to_hex(digest, out_hash);
+    return 0;
 }
 
-uint32_t* expand_message_deterministic(const char *text, size_t *out_len) {
-    size_t text_len = strlen(text);
-    *out_len = (text_len + 3) / 4;
+#define LINE_BATCH 1024
 
-    uint32_t *blocks = (uint32_t*)malloc(*out_len * sizeof(uint32_t));
-    if (!blocks) {
-        fprintf(stderr, "Memory allocation failed.\n");
-        exit(EXIT_FAILURE);
+typedef struct {
+    const uint8_t *msgs[LINE_BATCH];
+    size_t lens[LINE_BATCH];
+    uint8_t digests[LINE_BATCH][PLIR256_DIGEST_SIZE];
+    char out[LINE_BATCH * PLIR256_HEX_SIZE];
+    size_t count;
+} line_batch;
+
+/* Hashes the queued lines together and writes one "HASH\n" per line. */
+static int flush_lines(line_batch *b) {
+    if (b->count == 0) {
+        return 0;
+    }
+    plir256_hash_batch(b->msgs, b->lens, b->count, b->digests,
+                       PLIR256_DEFAULT_ROUNDS, PLIR256_DEFAULT_STAGES);
+    char *p = b->out;
+    for (size_t i = 0; i < b->count; i++) {
+        plir256_to_hex(b->digests[i], p);
+        p[PLIR256_HEX_SIZE - 1] = '\n';
+        p += PLIR256_HEX_SIZE;
+    }
+    size_t size = (size_t)(p - b->out);
+    b->count = 0;
+    return fwrite(b->out, 1, size, stdout) == size ? 0 : (errno ? errno : EIO);
+}
+
+/*
+ * Calls on_line for every newline-delimited record of fp (the '\n', if any,
+ * included in len). Records are read in large blocks and point into the
+ * block, so on_flush runs before the block is reused and at the end; a
+ * record longer than the block grows it. Returns 0 or an errno value, or the
+ * first non-zero value returned by a callback.
+ */
+static int read_lines(FILE *fp, int (*on_line)(void *ctx, const uint8_t *line, size_t len),
+                      int (*on_flush)(void *ctx), void *ctx) {
+    size_t capacity = 4 * READ_CHUNK_SIZE;
+    uint8_t *buffer = (uint8_t*)malloc(capacity);
+    if (!buffer) {
+        return ENOMEM;
     }
+    COUNT_ALLOC();
+
+    int err = 0;
+    size_t start = 0, end = 0;
+    for (;;) {
+        READ_BEGIN(t);
+        size_t read_bytes = fread(buffer + end, 1, capacity - end, fp);
+        READ_END(read_bytes, t);
+        end += read_bytes;
+        int eof = read_bytes == 0;
 
-    int sum_val = sum_ascii(text);
-    uint32_t seed = (uint32_t)(sum_val * 137);
+        for (;;) {
+            const uint8_t *nl = (const uint8_t*)memchr(buffer + start, '\n', end - start);
+            if (!nl && !(eof && start < end)) {
+                break;
+            }
+            size_t line_end = nl ? (size_t)(nl - buffer) + 1 : end;
+            err = on_line(ctx, buffer + start, line_end - start);
+            start = line_end;
+            if (err) {
+                break;
+            }
+        }
+        if (err || eof) {
+            break;
+        }
 
-    for (size_t i = 0; i < *out_len; i++) {
-        unsigned char chunk[4] = { ' ', ' ', ' ', ' ' };
-        size_t start_idx = i * 4;
-        for (size_t j = 0; j < 4; j++) {
-            if (start_idx + j < text_len) {
-                chunk[j] = (unsigned char)text[start_idx + j];
+        if ((err = on_flush(ctx)) != 0) {
+            break;
+        }
+        if (start == 0 && end == capacity) {
+            uint8_t *grown = (uint8_t*)realloc(buffer, capacity * 2);
+            if (!grown) {
+                err = ENOMEM;
+                break;
             }
+            COUNT_ALLOC();
+            buffer = grown;
+            capacity *= 2;
+        } else {
+            memmove(buffer, buffer + start, end - start);
+            end -= start;
+            start = 0;
         }
+    }
+    if (!err && ferror(fp)) {
+        err = errno ? errno : EIO;
+    }
+    if (!err) {
+        err = on_flush(ctx);
+    }
+    free(buffer);
+    return err;
+}
 
-        uint32_t block_val = (uint32_t)(chunk[0])
-                           | ((uint32_t)chunk[1] << 8)
-                           | ((uint32_t)chunk[2] << 16)
-                           | ((uint32_t)chunk[3] << 24);
+static int queue_line(void *ctx, const uint8_t *line, size_t len) {
+    line_batch *batch = (line_batch*)ctx;
+    batch->msgs[batch->count] = line;
+    batch->lens[batch->count] = trim_record(line, len);
+    batch->count++;
+    return batch->count == LINE_BATCH ? flush_lines(batch) : 0;
+}
 
-        uint32_t shift_val = seed >> (i % 16);
-        block_val ^= shift_val;
+static int flush_line_batch(void *ctx) {
+    return flush_lines((line_batch*)ctx);
+}
 
-        seed = rotate_left(seed, 5) ^ (seed * 71U);
-        blocks[i] = block_val;
+/*
+ * --lines: one hash per newline-delimited record of fp, each trimmed like a
+ * whole stdin input, hashed in batches of LINE_BATCH.
+ */
+int hash_lines(FILE *fp) {
+    line_batch *batch = (line_batch*)malloc(sizeof(line_batch));
+    if (!batch) {
+        return ENOMEM;
     }
+    batch->count = 0;
+    COUNT_ALLOC();
 
-    return blocks;
+    int err = read_lines(fp, queue_line, flush_line_batch, batch);
+    free(batch);
+    return err;
 }
 
-void single_stage_hash(const char *input_text, uint32_t prev_state, int rounds, char *out_hex) {
-    uint32_t seed = sum_ascii(input_text) * 137;
-    
-    uint32_t h[8];
-    h[0] = (0x86B47C4C ^ seed) ^ prev_state;
-    h[1] = (0xEEDFCBB3 ^ seed) ^ prev_state;  
-    h[2] = (0x1105DC08 ^ seed) ^ prev_state; 
-    h[3] = (0x21FB8A71 ^ seed) ^ prev_state; 
-    h[4] = (0x43B675C9 ^ seed) ^ prev_state;   
-    h[5] = (0x75B803D5 ^ seed) ^ prev_state;  
-    h[6] = (0x864FAAE8 ^ seed) ^ prev_state;  
-    h[7] = (0xD7C261FF ^ seed) ^ prev_state; 
-
-    size_t message_length;
-    uint32_t *message = expand_message_deterministic(input_text, &message_length);
+#ifndef _WIN32
+/*
+ * --build-index / --lookup: a sorted table of binary digests behind a
+ * 65536-entry table of where each 2-byte prefix starts, so a lookup is one
+ * bucket read plus a binary search over a few dozen entries. Like the digest
+ * cache it is in native byte order and is used through a read-only mapping,
+ * so every process looking up in the same index shares its page cache pages.
+ */
+#define INDEX_MAGIC   "PLIRIDX1"
+#define INDEX_VERSION 1
+#define INDEX_BUCKETS 65536
 
-    const uint32_t GOLDEN_RATIO_CONST = 0x9E3779B9;
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t digest_size;
+    uint64_t count;
+} index_header;
+
+/* Parses a line starting with 64 hex digits ("HASH" or "HASH  FILE"). */
+static int parse_digest_line(const uint8_t *line, size_t len, uint8_t digest[PLIR256_DIGEST_SIZE]) {
+    static const int8_t hex_value[256] = {
+        ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8,
+        ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15,
+        ['f'] = 16, ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+    };
+    const size_t hex_len = 2 * PLIR256_DIGEST_SIZE;
+    if (len < hex_len || (len > hex_len && !strchr(" \t\r\n", line[hex_len]))) {
+        return -1;
+    }
+    for (size_t i = 0; i < PLIR256_DIGEST_SIZE; i++) {
+        int hi = hex_value[line[2 * i]], lo = hex_value[line[2 * i + 1]];
+        if (!hi || !lo) {
+            return -1;
+        }
+        digest[i] = (uint8_t)((hi - 1) << 4 | (lo - 1));
+    }
+    return 0;
+}
 
-    for (int i = 0; i < rounds; i++) {
-        uint32_t key = GOLDEN_RATIO_CONST
-                     ^ (i * 73U)
-                     ^ (h[i % 8] << (i % 6))
-                     ^ (h[(i + 3) % 8] >> (i % 4))
-                     ^ (h[(i + 5) % 8] << (i % 8));
+static int is_blank_line(const uint8_t *line, size_t len) {
+    return trim_record(line, len) == 0;
+}
+
+static int compare_digests(const void *a, const void *b) {
+    return memcmp(a, b, PLIR256_DIGEST_SIZE);
+}
 
-        for (int j = 0; j < 8; j += 2) {
-            uint32_t prev_xor = h[(j + 1) % 8] ^ h[(j + 3) % 8];
+static size_t digest_bucket(const uint8_t digest[PLIR256_DIGEST_SIZE]) {
+    return (size_t)digest[0] << 8 | digest[1];
+}
 
-            h[j] = modular_mix(h[j], key)
-                 ^ (message[j % message_length] + GOLDEN_RATIO_CONST)
-                 ^ prev_xor;
-            h[j] &= 0xFFFFFFFF;
+typedef struct {
+    uint8_t (*digests)[PLIR256_DIGEST_SIZE];
+    size_t count;
+    size_t capacity;
+    const char *source;
+    size_t line_no;
+    size_t malformed;
+} index_builder;
 
-            h[j + 1] = modular_mix(h[j + 1], rotate_left(h[j], 13))
-                     ^ (h[(j + 3) % 8] >> 5)
-                     ^ (h[(j + 6) % 8] << 3)
-                     ^ rotate_left(h[(j + 7) % 8], 17)
-                     ^ prev_xor;
-            h[j + 1] &= 0xFFFFFFFF;
+static int collect_digest(void *ctx, const uint8_t *line, size_t len) {
+    index_builder *b = (index_builder*)ctx;
+    b->line_no++;
+    if (is_blank_line(line, len)) {
+        return 0;
+    }
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 65536;
+        uint8_t (*grown)[PLIR256_DIGEST_SIZE] =
+            (uint8_t (*)[PLIR256_DIGEST_SIZE])realloc(b->digests, capacity * PLIR256_DIGEST_SIZE);
+        if (!grown) {
+            return ENOMEM;
         }
+        b->digests = grown;
+        b->capacity = capacity;
     }
+    if (parse_digest_line(line, len, b->digests[b->count]) != 0) {
+        fprintf(stderr, "plirsum: %s: %zu: not a PLIR-256 hex digest\n", b->source, b->line_no);
+        b->malformed++;
+        return 0;
+    }
+    b->count++;
+    return 0;
+}
 
-    free(message);
-
-    sprintf(out_hex,
-            "%08x%08x%08x%08x%08x%08x%08x%08x",
-            h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+static int no_flush(void *ctx) {
+    (void)ctx;
+    return 0;
 }
 
-void secure_plir_256(const char *text, int rounds, int stages, char *out_hex) {
-    char stage_hash[65];
-    stage_hash[64] = '\0';
+/* Reads each list (stdin if none), then writes the sorted, deduplicated index. */
+int build_index(const char *index_path, char **lists, size_t list_count) {
+    index_builder b = { NULL, 0, 0, "-", 0, 0 };
+    int err = 0;
+    for (size_t i = 0; i < (list_count ? list_count : 1) && !err; i++) {
+        FILE *fp = list_count ? fopen(lists[i], "rb") : stdin;
+        b.source = list_count ? lists[i] : "-";
+        b.line_no = 0;
+        if (!fp) {
+            err = errno;
+            break;
+        }
+        err = read_lines(fp, collect_digest, no_flush, &b);
+        if (fp != stdin) {
+            fclose(fp);
+        }
+    }
+    if (err) {
+        fprintf(stderr, "plirsum: %s: %s\n", b.source, strerror(err));
+        free(b.digests);
+        return 1;
+    }
+
+    qsort(b.digests, b.count, PLIR256_DIGEST_SIZE, compare_digests);
+    size_t n = 0;
+    for (size_t i = 0; i < b.count; i++) {
+        if (n == 0 || memcmp(b.digests[n - 1], b.digests[i], PLIR256_DIGEST_SIZE) != 0) {
+            memmove(b.digests[n++], b.digests[i], PLIR256_DIGEST_SIZE);
+        }
+    }
 
-    uint32_t state = 0U;
-    char *current_input = (char*)malloc(strlen(text) + 1);
-    if (!current_input) {
+    uint64_t *buckets = (uint64_t*)calloc(INDEX_BUCKETS + 1, sizeof(uint64_t));
+    if (!buckets) {
         fprintf(stderr, "Memory allocation failed.\n");
-        exit(EXIT_FAILURE);
+        free(b.digests);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        buckets[digest_bucket(b.digests[i]) + 1]++;
     }
-    strcpy(current_input, text);
+    for (size_t k = 0; k < INDEX_BUCKETS; k++) {
+        buckets[k + 1] += buckets[k];
+    }
+
+    index_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, INDEX_MAGIC, 8);
+    hdr.version = INDEX_VERSION;
+    hdr.digest_size = PLIR256_DIGEST_SIZE;
+    hdr.count = n;
 
-    for (int s = 0; s < stages; s++) {
-        single_stage_hash(current_input, state, rounds, stage_hash);
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", index_path, (long)getpid());
+    FILE *out = fopen(tmp_path, "wb");
+    int ok = out && fwrite(&hdr, sizeof(hdr), 1, out) == 1
+          && fwrite(buckets, sizeof(uint64_t), INDEX_BUCKETS + 1, out) == INDEX_BUCKETS + 1
+          && fwrite(b.digests, PLIR256_DIGEST_SIZE, n, out) == n;
+    if (out && fclose(out) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_path, index_path) != 0) {
+        fprintf(stderr, "plirsum: %s: %s\n", index_path, strerror(errno ? errno : EIO));
+        remove(tmp_path);
+        ok = 0;
+    } else {
+        fprintf(stderr, "plirsum: %s: %zu digests (%zu duplicates, %zu malformed lines)\n",
+                index_path, n, b.count - n, b.malformed);
+    }
+    free(buckets);
+    free(b.digests);
+    return ok && !b.malformed ? 0 : 1;
+}
 
-        char temp[9];
-        memcpy(temp, stage_hash, 8);
-        temp[8] = '\0';
-        uint32_t partial = (uint32_t)strtoul(temp, NULL, 16);
-        state ^= partial;
+typedef struct {
+    const uint64_t *buckets;
+    const uint8_t (*digests)[PLIR256_DIGEST_SIZE];
+    const uint8_t *lines[LINE_BATCH];
+    size_t lens[LINE_BATCH];
+    uint8_t keys[LINE_BATCH][PLIR256_DIGEST_SIZE];
+    size_t count;
+    size_t found;
+    size_t malformed;
+    const char *source;
+    size_t line_no;
+} index_lookup;
 
-        free(current_input);
-        current_input = (char*)malloc(65);
-        if (!current_input) {
-            fprintf(stderr, "Memory allocation failed.\n");
-            exit(EXIT_FAILURE);
+/*
+ * Looks up a batch of digests: all bucket ranges are prefetched first so the
+ * cache misses of different lookups overlap, then each range is searched.
+ * Matching input lines are written unchanged.
+ */
+static int lookup_batch(void *ctx) {
+    index_lookup *q = (index_lookup*)ctx;
+    for (size_t i = 0; i < q->count; i++) {
+        size_t bucket = digest_bucket(q->keys[i]);
+        __builtin_prefetch(&q->buckets[bucket]);
+        __builtin_prefetch(q->digests[q->buckets[bucket]]);
+    }
+    for (size_t i = 0; i < q->count; i++) {
+        size_t bucket = digest_bucket(q->keys[i]);
+        uint64_t lo = q->buckets[bucket], hi = q->buckets[bucket + 1];
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            int c = memcmp(q->digests[mid], q->keys[i], PLIR256_DIGEST_SIZE);
+            if (c == 0) {
+                size_t len = q->lens[i];
+                if (len > 0 && q->lines[i][len - 1] == '\n') {
+                    len--;
+                }
+                if (fwrite(q->lines[i], 1, len, stdout) != len || putchar('\n') == EOF) {
+                    return errno ? errno : EIO;
+                }
+                q->found++;
+                break;
+            }
+            if (c < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
         }
-        strcpy(current_input, stage_hash);
     }
+    q->count = 0;
+    return 0;
+}
+
+static int queue_lookup(void *ctx, const uint8_t *line, size_t len) {
+    index_lookup *q = (index_lookup*)ctx;
+    q->line_no++;
+    if (is_blank_line(line, len)) {
+        return 0;
+    }
+    if (parse_digest_line(line, len, q->keys[q->count]) != 0) {
+        fprintf(stderr, "plirsum: %s: %zu: not a PLIR-256 hex digest\n", q->source, q->line_no);
+        q->malformed++;
+        return 0;
+    }
+    q->lines[q->count] = line;
+    q->lens[q->count] = len;
+    q->count++;
+    return q->count == LINE_BATCH ? lookup_batch(q) : 0;
+}
+
+#define INDEX_TABLE_SIZE (sizeof(index_header) + (INDEX_BUCKETS + 1) * sizeof(uint64_t))
 
-    strcpy(out_hex, stage_hash);
-    free(current_input);
+/*
+ * The header count must match the file size and the bucket offsets must climb
+ * from 0 to that count, so every search stays inside the mapping.
+ */
+static int index_valid(const uint8_t *data, size_t size) {
+    const index_header *hdr = (const index_header*)data;
+    if (size < INDEX_TABLE_SIZE || memcmp(hdr->magic, INDEX_MAGIC, 8) != 0
+        || hdr->version != INDEX_VERSION || hdr->digest_size != PLIR256_DIGEST_SIZE
+        || (size - INDEX_TABLE_SIZE) % PLIR256_DIGEST_SIZE != 0
+        || hdr->count != (size - INDEX_TABLE_SIZE) / PLIR256_DIGEST_SIZE) {
+        return 0;
+    }
+    const uint64_t *buckets = (const uint64_t*)(data + sizeof(index_header));
+    if (buckets[0] != 0 || buckets[INDEX_BUCKETS] != hdr->count) {
+        return 0;
+    }
+    for (size_t k = 0; k < INDEX_BUCKETS; k++) {
+        if (buckets[k] > buckets[k + 1]) {
+            return 0;
+        }
+    }
+    return 1;
 }
 
-int hash_file_contents(const char *filename, char *out_hash) {
-    FILE *fp = fopen(filename, "rb");
+/*
+ * --lookup INDEX: prints the lines of each list (stdin if none) whose digest
+ * is in INDEX. Exit status as grep: 0 if any matched, 1 if none, 2 on error.
+ */
+int lookup_index(const char *index_path, char **lists, size_t list_count) {
+    FILE *fp = fopen(index_path, "rb");
+    const uint8_t *data;
+    size_t size;
     if (!fp) {
-        perror("Could not open file");
-        return 1;
+        fprintf(stderr, "plirsum: %s: %s\n", index_path, strerror(errno));
+        return 2;
     }
+    int mapped = map_file(fp, &data, &size) == 0;
+    fclose(fp);
 
-    if (fseek(fp, 0, SEEK_END) != 0) {
-        perror("fseek error");
-        fclose(fp);
-        return 1;
-    }
-    long size = ftell(fp);
-    if (size < 0) {
-        perror("ftell error");
-        fclose(fp);
-        return 1;
+    if (!mapped || !index_valid(data, size)) {
+        fprintf(stderr, "plirsum: %s: not a valid digest index\n", index_path);
+        if (mapped) {
+            munmap((void *)data, size);
+        }
+        return 2;
     }
-    rewind(fp);
+    madvise((void *)data, size, MADV_RANDOM);
 
-    char *buffer = (char*)malloc((size_t)size + 1);
-    if (!buffer) {
+    index_lookup *q = (index_lookup*)malloc(sizeof(index_lookup));
+    if (!q) {
         fprintf(stderr, "Memory allocation failed.\n");
-        fclose(fp);
-        return 1;
+        munmap((void *)data, size);
+        return 2;
     }
+    q->buckets = (const uint64_t*)(data + sizeof(index_header));
+    q->digests = (const uint8_t (*)[PLIR256_DIGEST_SIZE])(data + INDEX_TABLE_SIZE);
+    q->count = q->found = q->malformed = 0;
 
-    size_t read_bytes = fread(buffer, 1, (size_t)size, fp);
-    fclose(fp);
+    static char out_buffer[1 << 20];
+    setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+
+    int err = 0;
+    for (size_t i = 0; i < (list_count ? list_count : 1) && !err; i++) {
+        FILE *in = list_count ? fopen(lists[i], "rb") : stdin;
+        q->source = list_count ? lists[i] : "-";
+        q->line_no = 0;
+        if (!in) {
+            err = errno;
+            break;
+        }
+        err = read_lines(in, queue_lookup, lookup_batch, q);
+        if (in != stdin) {
+            fclose(in);
+        }
+    }
+    if (!err && fflush(stdout) != 0) {
+        err = errno ? errno : EIO;
+    }
+    if (err) {
+        fprintf(stderr, "plirsum: %s: %s\n", q->source, strerror(err));
+    }
 
-    buffer[read_bytes] = '\0';
+    int rc = err || q->malformed ? 2 : (q->found ? 0 : 1);
+    free(q);
+    munmap((void *)data, size);
+    return rc;
+}
+#endif
 
-    secure_plir_256(buffer, 8, 2, out_hash);
+static int stats_json = 0;
+static uint64_t stats_start_ns;
 
-    free(buffer);
-    return 0;
+/* Registered with atexit() by --stats; writes to stderr so stdout stays parseable. */
+static void print_stats(void) {
+    fflush(stdout);
+#ifdef PLIR256_STATS
+    plir256_phase_stats phases[PLIR256_PHASE_COUNT];
+    plir256_stats(phases);
+    unsigned long long wall_ns = (unsigned long long)(get_nanotime() - stats_start_ns);
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "tsc";
+#else
+    const char *unit = "ns";
+#endif
+
+    if (stats_json) {
+        fprintf(stderr, "{\"wall_ns\":%llu,\"cycle_unit\":\"%s\",\"phases\":[", wall_ns, unit);
+        for (int p = 0; p < PLIR256_PHASE_COUNT; p++) {
+            fprintf(stderr, "%s{\"name\":\"%s\",\"calls\":%llu,\"bytes\":%llu,\"cycles\":%llu}",
+                    p ? "," : "", plir256_phase_name(p), (unsigned long long)phases[p].calls,
+                    (unsigned long long)phases[p].bytes, (unsigned long long)phases[p].cycles);
+        }
+        fprintf(stderr, "],\"read\":{\"calls\":%llu,\"bytes\":%llu,\"ns\":%llu},\"allocations\":%llu}\n",
+                (unsigned long long)read_stats.calls, (unsigned long long)read_stats.bytes,
+                (unsigned long long)read_stats.cycles, (unsigned long long)alloc_count);
+        return;
+    }
+
+    fprintf(stderr, "%-8s %14s %18s %18s %12s\n", "phase", "calls", "bytes", unit, "per call");
+    for (int p = 0; p < PLIR256_PHASE_COUNT; p++) {
+        fprintf(stderr, "%-8s %14llu %18llu %18llu %12.1f\n", plir256_phase_name(p),
+                (unsigned long long)phases[p].calls, (unsigned long long)phases[p].bytes,
+                (unsigned long long)phases[p].cycles,
+                phases[p].calls ? (double)phases[p].cycles / (double)phases[p].calls : 0.0);
+    }
+    fprintf(stderr, "%-8s %14llu %18llu %15llu ns %12.1f\n", "read",
+            (unsigned long long)read_stats.calls, (unsigned long long)read_stats.bytes,
+            (unsigned long long)read_stats.cycles,
+            read_stats.calls ? (double)read_stats.cycles / (double)read_stats.calls : 0.0);
+    fprintf(stderr, "allocations %llu, wall time %.3f ms\n",
+            (unsigned long long)alloc_count, (double)wall_ns / 1e6);
+#else
+    fprintf(stderr, "plirsum: --stats needs a build with per-phase counters (make STATS=1)\n");
+#endif
+}
+
+int default_jobs(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
 }
 
-void generate_random_hex(int N) {
+/*
+ * Fills seed from the operating system's random source. On Windows the seed
+ * is still derived from the Golden Ratio constant and the nanosecond clock.
+ */
+int random_seed(uint8_t seed[PLIR256_DIGEST_SIZE]) {
+#if defined(__linux__)
+    size_t got = 0;
+    while (got < PLIR256_DIGEST_SIZE) {
+        ssize_t n = getrandom(seed + got, PLIR256_DIGEST_SIZE - got, 0);
+        if (n < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (n > 0) {
+            got += (size_t)n;
+        }
+    }
+    return 0;
+#elif !defined(_WIN32)
+    FILE *fp = fopen("/dev/urandom", "rb");
+    if (!fp) {
+        return -1;
+    }
+    size_t got = fread(seed, 1, PLIR256_DIGEST_SIZE, fp);
+    fclose(fp);
+    return got == PLIR256_DIGEST_SIZE ? 0 : -1;
+#else
     const uint32_t GOLDEN_RATIO_CONST = 0x9E3779B9;
-    uint64_t nanosec = get_nanotime();
-    
     char seed_input[64];
-    snprintf(seed_input, sizeof(seed_input), "%08x%016llx", GOLDEN_RATIO_CONST, nanosec);
-    
-    char hash_output[65];
-    secure_plir_256(seed_input, 8, 2, hash_output);
-    
+    snprintf(seed_input, sizeof(seed_input), "%08x%016llx", GOLDEN_RATIO_CONST, get_nanotime());
+    plir256((const uint8_t *)seed_input, strlen(seed_input), seed);
+    return 0;
+#endif
+}
+
+static const char token_hex[] = "0123456789abcdef";
+
+/*
+ * Writes N (at most 64) random salt characters and a NUL to out. Salts use
+ * the letters a-p, 4 bits each, so a record's ITER digits always end where
+ * the salt starts.
+ */
+int random_salt(char *out, int N) {
+    uint8_t seed[PLIR256_DIGEST_SIZE], bytes[PLIR256_DIGEST_SIZE];
+    if (random_seed(seed) != 0) {
+        return -1;
+    }
+    plir256_keystream(seed, 0, bytes, sizeof(bytes));
     for (int i = 0; i < N && i < 64; i++) {
-        putchar(hash_output[i]);
+        out[i] = (char)('a' + ((bytes[i / 2] >> (i % 2 ? 0 : 4)) & 15));
+    }
+    out[N < 64 ? N : 64] = '\0';
+    return 0;
+}
+
+#define TOKEN_STREAM_SIZE (64 * 1024)
+
+/*
+ * --rand N [--count M]: M tokens of N hex characters, one per line, cut from
+ * a single keystream seeded once and written through one large buffer. Both
+ * buffers are sized down to what M tokens need.
+ */
+int generate_random_hex(int N, uint64_t count) {
+    uint8_t seed[PLIR256_DIGEST_SIZE];
+    if (random_seed(seed) != 0) {
+        fprintf(stderr, "plirsum: random source: %s\n", strerror(errno ? errno : EIO));
+        return 1;
+    }
+
+    size_t token_bytes = ((size_t)N + 1) / 2;
+    size_t stream_size = TOKEN_STREAM_SIZE, out_size = 16 * TOKEN_STREAM_SIZE;
+    if (count < stream_size / token_bytes) {
+        stream_size = ((size_t)count * token_bytes + PLIR256_DIGEST_SIZE - 1)
+                    / PLIR256_DIGEST_SIZE * PLIR256_DIGEST_SIZE;
+    }
+    if (count < out_size / ((size_t)N + 1)) {
+        out_size = (size_t)count * ((size_t)N + 1);
+    }
+
+    uint8_t *stream = (uint8_t*)malloc(stream_size);
+    char *out = (char*)malloc(out_size);
+    if (!stream || !out) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        free(stream);
+        free(out);
+        return 1;
+    }
+
+    size_t pos = stream_size, used = 0;
+    uint64_t counter = 0;
+    int rc = 0;
+    for (uint64_t t = 0; t < count; t++) {
+        if (pos + token_bytes > stream_size) {
+            plir256_keystream(seed, counter, stream, stream_size);
+            counter += stream_size / PLIR256_DIGEST_SIZE;
+            pos = 0;
+        }
+        if (used + (size_t)N + 1 > out_size) {
+            if (fwrite(out, 1, used, stdout) != used) {
+                rc = 1;
+                break;
+            }
+            used = 0;
+        }
+        const uint8_t *b = stream + pos;
+        for (int i = 0; i < N; i++) {
+            out[used++] = token_hex[(b[i / 2] >> (i % 2 ? 0 : 4)) & 15];
+        }
+        out[used++] = '\n';
+        pos += token_bytes;
+    }
+    if (!rc && fwrite(out, 1, used, stdout) != used) {
+        rc = 1;
+    }
+    memset(seed, 0, sizeof(seed));
+    free(stream);
+    free(out);
+    if (rc) {
+        fprintf(stderr, "plirsum: write error: %s\n", strerror(errno ? errno : EIO));
+    }
+    return rc;
+}
+
+/*
+ * --kdf ITER [SALT]: reads the password from standard input (trimmed like any
+ * stdin input) and prints the ITER + SALT + HASH record. Without SALT a
+ * 16-character one is generated. A SALT starting with a digit is refused, as
+ * the record could not be split back into ITER and SALT.
+ */
+int kdf_record(const char *iter_arg, const char *salt_arg) {
+    char *end;
+    errno = 0;
+    unsigned long long iterations = strtoull(iter_arg, &end, 10);
+    if (errno || end == iter_arg || *end != '\0' || iterations == 0
+        || iterations > PLIR256_KDF_MAX_ITERATIONS || iter_arg[0] < '1' || iter_arg[0] > '9') {
+        fprintf(stderr, "Invalid ITER value, must be between 1 and %u.\n",
+                (unsigned)PLIR256_KDF_MAX_ITERATIONS);
+        return 1;
+    }
+
+    char salt[65];
+    if (salt_arg) {
+        snprintf(salt, sizeof(salt), "%s", salt_arg);
+        if (strlen(salt_arg) >= sizeof(salt)) {
+            fprintf(stderr, "Invalid SALT value, must be at most 64 characters.\n");
+            return 1;
+        }
+        if (salt[0] >= '0' && salt[0] <= '9') {
+            fprintf(stderr, "Invalid SALT value, must not start with a digit.\n");
+            return 1;
+        }
+    } else if (random_salt(salt, 16) != 0) {
+        fprintf(stderr, "plirsum: random source: %s\n", strerror(errno ? errno : EIO));
+        return 1;
+    }
+
+    size_t len;
+    char *password = read_all(stdin, &len);
+    if (!password) {
+        fprintf(stderr, "plirsum: -: %s\n", strerror(errno ? errno : EIO));
+        return 1;
     }
-    putchar('\n');
+    len = trim_record((const uint8_t *)password, len);
+
+    uint8_t digest[PLIR256_DIGEST_SIZE];
+    char hex[PLIR256_HEX_SIZE];
+    plir256_kdf((const uint8_t *)password, len, (const uint8_t *)salt, strlen(salt),
+                (uint32_t)iterations, digest);
+    plir256_to_hex(digest, hex);
+    memset(password, 0, len);
+    free(password);
+
+    printf("%llu%s%s\n", iterations, salt, hex);
+    return 0;
 }
 
 void print_last_n_digits_of_nanotime(int N) {
@@ -231,14 +2461,22 @@ void print_last_n_digits_of_nanotime(int N) {
 int main(int argc, char *argv[]) {
     const char* VERSION = "6.9";
 
-    if (argc == 3 && strcmp(argv[1], "--rand") == 0) {
+    if ((argc == 3 || (argc == 5 && strcmp(argv[3], "--count") == 0)) && strcmp(argv[1], "--rand") == 0) {
         int N = atoi(argv[2]);
         if (N <= 0 || N > 64) {
             fprintf(stderr, "Invalid N value, must be between 1 and 64.\n");
             return 1;
         }
-        generate_random_hex(N);
-        return 0;
+        long long M = argc == 5 ? atoll(argv[4]) : 1;
+        if (M <= 0) {
+            fprintf(stderr, "Invalid M value, must be greater than 0.\n");
+            return 1;
+        }
+        return generate_random_hex(N, (uint64_t)M);
+    }
+
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "--kdf") == 0) {
+        return kdf_record(argv[2], argc == 4 ? argv[3] : NULL);
     }
 
     if (argc == 3 && strcmp(argv[1], "--randit") == 0) {
@@ -256,18 +2494,55 @@ int main(int argc, char *argv[]) {
             printf(
                 "PLIR-256 %s\n\n"
                 "Usage:\n"
-                "  %s [FILE]\n"
-                "      Computes a PLIR-256 hash of the provided FILE.\n"
-                "      If FILE is not specified, the program reads from standard input.\n\n"
+                "  %s [-j N] [-r] [FILE]...\n"
+                "      Computes a PLIR-256 hash of each FILE.\n"
+                "      If no FILE is specified, the program reads from standard input\n"
+                "      (one trailing newline, carriage return and space are ignored).\n"
+                "  %s --lines\n"
+                "      Prints the hash of each line of standard input, trimmed the same way.\n\n"
                 "Options:\n"
                 "  -h, --help      Display this help message.\n"
                 "  -v, --version   Display the program version.\n"
-                "  --rand N        Generate N random hexadecimal characters (1-64).\n"
-                "                  Uses hashing of Golden Ratio + Epochtime Nanosecond.\n"
-                "                  Example: plirsum.exe --rand 16\n"
+                "  -j, --jobs N    Hash up to N files in parallel (default: online CPUs).\n"
+                "  --tree          Use PLIR-256 tree mode (v1, 1 MiB leaves): a single large\n"
+                "                  FILE is hashed on all -j threads. Tree hashes differ from\n"
+                "                  plain hashes; combine with -c to verify tree manifests.\n"
+                "  -c, --check MANIFEST\n"
+                "                  Verify the HASH  FILENAME lines in MANIFEST ('-' for stdin)\n"
+                "                  and print FILENAME: OK or FAILED for each.\n"
+                "  -r, --recursive Hash the regular files under each DIRECTORY operand, in\n"
+                "                  sorted order, reading many files at once (io_uring rings\n"
+                "                  on the -j threads where available, otherwise -j reader\n"
+                "                  threads).\n"
+                "  --dups DIR...   Print groups of identical files under each DIR, largest\n"
+                "                  first. Only files sharing a size are read, and only those\n"
+                "                  whose first and last 4 KiB match are compared byte by\n"
+                "                  byte. Hard links to one file count as one file.\n"
+                "  --stats[=json]  Print per-phase counters (calls, bytes, cycles) and read\n"
+                "                  and allocation totals to stderr on exit; needs a build\n"
+                "                  with make STATS=1.\n"
+                "  --build-index INDEX [LIST]...\n"
+                "                  Store the digests of the HASH or HASH  FILE lines of each\n"
+                "                  LIST (default: stdin) in a sorted binary INDEX.\n"
+                "  --lookup INDEX [LIST]...\n"
+                "                  Print the lines of each LIST (default: stdin) whose digest\n"
+                "                  is in INDEX; exit 0 if any matched, 1 if none, 2 on error.\n"
+                "  --cache FILE    Reuse digests stored in FILE for files whose device, inode,\n"
+                "                  size and modification time are unchanged, and add new ones.\n"
+                "  --rand N [--count M]\n"
+                "                  Generate M (default 1) tokens of N random hexadecimal\n"
+                "                  characters (1-64), one per line, from a PLIR-256\n"
+                "                  counter-mode keystream seeded by getrandom().\n"
+                "                  Example: plirsum.exe --rand 16 --count 1000000\n"
                 "  --randit N      Generate dynamic iteration count for hashing.\n"
-                "                  Example: plirsum.exe --randit 8\n\n",
-                VERSION, argv[0]
+                "                  Example: plirsum.exe --randit 8\n"
+                "  --kdf ITER [SALT]\n"
+                "                  Hash the password on standard input with SALT (default:\n"
+                "                  16 random letters a-p) over ITER (1-100000) iterations\n"
+                "                  and print the ITER + SALT + HASH record. SALT must not\n"
+                "                  start with a digit.\n"
+                "                  Example: echo mypassword | plirsum.exe --kdf 1255\n\n",
+                VERSION, argv[0], argv[0]
             );
             return 0;
         }
@@ -277,34 +2552,175 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    char hash_result[65];
-    hash_result[64] = '\0';
+    int jobs = default_jobs();
+    int lines_mode = 0;
+    int dups_mode = 0;
+    int index_build = 0;
+    const char *index_path = NULL;
+    const char *manifest = NULL;
+    char **files = (char**)malloc((size_t)argc * sizeof(char*));
+    size_t file_count = 0;
+    if (!files) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return 1;
+    }
 
-    if (argc == 2) {
-        if (hash_file_contents(argv[1], hash_result) == 0) {
-            printf("%s  %s\n", hash_result, argv[1]);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+            if (i + 1 == argc || (jobs = atoi(argv[++i])) <= 0) {
+                fprintf(stderr, "Invalid N value, must be greater than 0.\n");
+                return 1;
+            }
+        } else if (strncmp(arg, "-j", 2) == 0 && arg[2] != '\0') {
+            if ((jobs = atoi(arg + 2)) <= 0) {
+                fprintf(stderr, "Invalid N value, must be greater than 0.\n");
+                return 1;
+            }
+        } else if (strcmp(arg, "--tree") == 0) {
+            tree_mode = 1;
+        } else if (strcmp(arg, "--lines") == 0) {
+            lines_mode = 1;
+        } else if (strcmp(arg, "--stats") == 0 || strcmp(arg, "--stats=json") == 0) {
+            stats_json = arg[7] == '=';
+            stats_start_ns = get_nanotime();
+            atexit(print_stats);
+#ifndef _WIN32
+        } else if (strcmp(arg, "-r") == 0 || strcmp(arg, "--recursive") == 0) {
+            recursive = 1;
+        } else if (strcmp(arg, "--dups") == 0) {
+            dups_mode = 1;
+        } else if (strcmp(arg, "--build-index") == 0 || strcmp(arg, "--lookup") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "%s requires an INDEX argument.\n", arg);
+                return 1;
+            }
+            index_build = arg[2] == 'b';
+            index_path = argv[++i];
+        } else if (strcmp(arg, "--cache") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "%s requires a FILE argument.\n", arg);
+                return 1;
+            }
+            cache_path = argv[++i];
+#endif
+        } else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--check") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "%s requires a MANIFEST argument.\n", arg);
+                return 1;
+            }
+            manifest = argv[++i];
+        } else if (strcmp(arg, "--") == 0) {
+            while (++i < argc) {
+                files[file_count++] = argv[i];
+            }
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            fprintf(stderr, "Unknown option: %s\nTry '%s --help'.\n", arg, argv[0]);
+            return 1;
+        } else {
+            files[file_count++] = argv[i];
         }
-        return 0;
     }
 
-    char input_text[1024] = {0};
-    size_t bytes_read = fread(input_text, 1, sizeof(input_text) - 1, stdin);
-    input_text[bytes_read] = '\0';
+#ifndef _WIN32
+    if (cache_path) {
+        cache_load(cache_path);
+    }
+#endif
+
+    if (lines_mode && (manifest || file_count > 0 || tree_mode)) {
+        fprintf(stderr, "--lines reads standard input only and cannot be combined with FILE, -c or --tree.\n");
+        return 1;
+    }
+
+#ifndef _WIN32
+    if (index_path) {
+        int rc = index_build ? build_index(index_path, files, file_count)
+                             : lookup_index(index_path, files, file_count);
+        free(files);
+        return rc;
+    }
+
+    if (dups_mode) {
+        if (file_count == 0 || manifest) {
+            fprintf(stderr, "--dups requires at least one DIRECTORY and cannot be combined with -c.\n");
+            return 1;
+        }
+        int rc = find_dups(files, file_count, jobs);
+        free(files);
+        return rc;
+    }
+#endif
+
+    if (manifest) {
+        free(files);
+        return check_manifest(manifest, jobs);
+    }
+
+#ifndef _WIN32
+    if (recursive) {
+        file_list list = { NULL, 0, 0 };
+        size_t failed = 0;
+        for (size_t i = 0; i < file_count; i++) {
+            failed += walk_path(files[i], 1, &list);
+        }
+        free(files);
+        if (file_count == 0) {
+            fprintf(stderr, "-r requires at least one FILE or DIRECTORY.\n");
+            return 1;
+        }
+        int rc = list.count ? hash_files(list.names, list.count, jobs) : 0;
+        for (size_t i = 0; i < list.count; i++) {
+            free(list.names[i]);
+        }
+        free(list.names);
+        return (rc || failed) ? 1 : 0;
+    }
+#endif
 
-    size_t len = strlen(input_text);
-    if (len > 0 && input_text[len - 1] == '\n') {
-        input_text[--len] = '\0';
+    if (tree_mode && file_count <= 1) {
+        tree_threads = jobs;
     }
-    if (len > 0 && input_text[len - 1] == '\r') {
-        input_text[--len] = '\0';
+
+    if (file_count > 0) {
+        int rc = hash_files(files, file_count, jobs);
+        free(files);
+        return rc;
     }
+    free(files);
+
+    char hash_result[65];
+    hash_result[64] = '\0';
 
-    if (len > 0 && input_text[len - 1] == ' ') {
-        input_text[--len] = '\0';
+    if (lines_mode) {
+        static char out_buffer[1 << 20];
+        setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+        int err = hash_lines(stdin);
+        if (!err && fflush(stdout) != 0) {
+            err = errno ? errno : EIO;
+        }
+        if (err) {
+            fprintf(stderr, "plirsum: -: %s\n", strerror(err));
+            return 1;
+        }
+        return 0;
     }
 
-    secure_plir_256(input_text, 8, 2, hash_result);
+    if (tree_mode) {
+        int err = hash_tree_stream(stdin, hash_result);
+        if (err) {
+            fprintf(stderr, "plirsum: -: %s\n", strerror(err));
+            return 1;
+        }
+        printf("%s  -\n", hash_result);
+        return 0;
+    }
 
+    int err = hash_stdin(stdin, hash_result);
+    if (err) {
+        fprintf(stderr, "plirsum: -: %s\n", strerror(err));
+        return 1;
+    }
     printf("%s  -\n", hash_result);
 
     return 0;